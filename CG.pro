@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -27,11 +27,37 @@ CONFIG += c++17
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-    primitive.cpp
+    primitive.cpp \
+    canvas.cpp \
+    store.cpp \
+    history.cpp \
+    clipper.cpp \
+    grid.cpp \
+    spans.cpp \
+    renderer.cpp \
+    viewport.cpp \
+    scene.cpp \
+    exporter.cpp \
+    latency.cpp \
+    profiler.cpp
 
 HEADERS += \
         mainwindow.h \
-    primitive.h
+    primitive.h \
+    canvas.h \
+    store.h \
+    history.h \
+    clipper.h \
+    grid.h \
+    raster.h \
+    stroker.h \
+    spans.h \
+    renderer.h \
+    viewport.h \
+    scene.h \
+    exporter.h \
+    latency.h \
+    profiler.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,669 @@
+#include "primitive.h"
+#include "clipper.h"
+#include "grid.h"
+#include "viewport.h"
+#include "canvas.h"
+#include "scene.h"
+#include "store.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTemporaryFile>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+// 光栅化和裁剪的微基准：cg-bench [--json] [--time ms] [过滤字符串]
+// 正确性检查：cg-bench --check [过滤字符串]，与逐像素的参考实现或原有路径比较，有失败时返回1
+
+// 统计堆分配次数，衡量每次调用的内存分配开销
+static std::atomic<quint64> allocations(0);
+static volatile int sink;	// 保存结果，防止编译器优化掉被测代码
+
+#if defined(__GLIBC__)
+// Qt容器经QArrayData::allocate直接调用malloc和realloc，不经过operator new，只有在malloc一层统计才能
+// 覆盖所有分配。glibc允许程序自己定义这几个函数，这里计数后转交给glibc的实现，operator new也经过malloc
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size)
+{
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    ++allocations;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    ++allocations;
+    return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+}
+static const bool countAllocations = true;
+#else
+// 其他平台没有可靠的malloc拦截方式，不报告分配次数，以免给出只统计了operator new的错误数字
+static const bool countAllocations = false;
+#endif
+
+struct Case
+{
+    QString name;					// 用例名称
+    std::function<int()> run;		// 运行一次，返回生成的像素数
+};
+
+struct Result
+{
+    qint64 iterations;	// 运行次数
+    double ns;			// 每次耗时
+    double pixels;		// 每秒像素数
+    double allocs;		// 每次分配次数，无法统计时为-1
+};
+
+// 倍增运行次数直到总耗时超过下限，避免计时精度影响结果
+static Result measure(const Case &c, qint64 minTime)
+{
+    for (qint64 n = 1; ; n *= 2)
+    {
+        quint64 before = allocations;
+        qint64 pixels = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 i = 0; i < n; ++i)
+            pixels += c.run();
+        qint64 elapsed = timer.nsecsElapsed();
+        sink = int(pixels);
+        if (elapsed >= minTime * 1000000 || n >= (qint64(1) << 40))
+        {
+            Result r;
+            r.iterations = n;
+            r.ns = double(elapsed) / n;
+            r.pixels = elapsed ? pixels * 1e9 / elapsed : 0;
+            r.allocs = countAllocations ? double(allocations - before) / n : -1;
+            return r;
+        }
+    }
+}
+
+static QVector<Case> cases()
+{
+    QVector<Case> list;
+    // 直线：不同斜率和长度
+    struct { const char *name; int dx, dy; } slopes[] =
+    {
+        {"horizontal", 1, 0}, {"shallow", 2, 1}, {"diagonal", 1, 1}, {"steep", 1, 2}, {"vertical", 0, 1}
+    };
+    for (auto s : slopes)
+        for (int len : {16, 256, 2048})
+        {
+            QVector<QPoint> args = {{0, 0}, QPoint(s.dx, s.dy) * len / qMax(s.dx, s.dy)};
+            list.append({QString("line/%1/%2").arg(s.name).arg(len),
+                         [=] { return Primitive::drawLine(args).size(); }});
+        }
+    // 多边形：顶点数
+    for (int n : {3, 16, 256})
+    {
+        QVector<QPoint> args;
+        for (int i = 0; i < n; ++i)
+            args.append(QPoint(qRound(400 + 300 * qCos(2 * M_PI * i / n)), qRound(400 + 300 * qSin(2 * M_PI * i / n))));
+        list.append({QString("polygon/%1").arg(n), [=] { return Primitive::drawPolygon(args).size(); }});
+    }
+    // 圆形：半径
+    for (int r : {4, 64, 1024})
+    {
+        QVector<QPoint> args = {{0, 0}, {r, r}};
+        list.append({QString("circle/%1").arg(r), [=] { return Primitive::drawCircle(args).size(); }});
+    }
+    // 椭圆：长轴在横向和纵向（交换坐标的路径）
+    for (QPoint r : {QPoint(64, 16), QPoint(16, 64), QPoint(1024, 256), QPoint(256, 1024)})
+    {
+        QVector<QPoint> args = {{0, 0}, r};
+        list.append({QString("ellipse/%1x%2").arg(r.x()).arg(r.y()),
+                     [=] { return Primitive::drawEllipse(args).size(); }});
+    }
+    // 圆弧和椭圆弧：可见部分占整个图形的比例，耗时应与可见部分成正比
+    for (qreal part : {0.01, 0.25, 1.0})
+    {
+        Ranges ranges = {qMakePair(0.3, 0.3 + 2 * M_PI * part)};
+        list.append({QString("arc/circle/%1").arg(part), [=]
+        {
+            QVector<QPoint> points;
+            VectorSink sink(points);
+            Raster::circle(QPoint(0, 0), 1024, sink, part < 1 ? ranges : Ranges());
+            return points.size();
+        }});
+        list.append({QString("arc/ellipse/%1").arg(part), [=]
+        {
+            QVector<QPoint> points;
+            VectorSink sink(points);
+            Raster::ellipse(QPoint(0, 0), 1024, 256, sink, part < 1 ? ranges : Ranges());
+            return points.size();
+        }});
+    }
+    // 粗画笔描边：画笔宽度，耗时应与描边面积成正比
+    for (int w : {1, 4, 16, 64})
+    {
+        auto p = std::make_shared<Primitive>(QPen(Qt::black, w), Primitive::Circle, QVector<QPoint>{{512, 512}, {400, 400}});
+        auto image = std::make_shared<QImage>(1024, 1024, QImage::Format_RGB32);
+        list.append({QString("stroke/circle/%1").arg(w), [=]
+        {
+            ImageSink sink(*image, image->rect(), p->pen().color().rgba());
+            p->stroke(sink, image->rect());
+            return p->spans().pixels();
+        }});
+    }
+    // 像素格式特化的绘制函数：细画笔直接写入，粗画笔经描边器合并后写入，与上面通用接收器的stroke/circle对比
+    for (QImage::Format format : {QImage::Format_RGB32, QImage::Format_ARGB32_Premultiplied})
+        for (int w = 1; w <= 4; ++w)
+        {
+            auto p = std::make_shared<Primitive>(QPen(Qt::black, w), Primitive::Circle, QVector<QPoint>{{512, 512}, {400, 400}});
+            auto image = std::make_shared<QImage>(1024, 1024, format);
+            list.append({QString("draw/circle/%1/%2").arg(w).arg(format == QImage::Format_RGB32 ? "rgb32" : "argb32pm"), [=]
+            {
+                p->draw(image->bits(), image->bytesPerLine(), image->format(), image->rect());
+                return p->spans().pixels();
+            }});
+        }
+    // 填充：自交星形多边形的两种规则和大椭圆，写入RGB32画布，耗时应接近内存带宽
+    for (Qt::FillRule rule : {Qt::OddEvenFill, Qt::WindingFill})
+    {
+        QVector<QPoint> star;
+        for (int i = 0; i < 7; ++i)
+            star.append(QPoint(1024 + qRound(1000 * qCos(i * 6 * M_PI / 7)), 1024 + qRound(1000 * qSin(i * 6 * M_PI / 7))));
+        auto image = std::make_shared<QImage>(2048, 2048, QImage::Format_RGB32);
+        CountSink count;
+        Raster::fillPolygon(star, rule, count);
+        list.append({QString("fill/star/%1").arg(rule == Qt::OddEvenFill ? "evenodd" : "nonzero"), [=]
+        {
+            ImageSink sink(*image, image->rect(), qRgb(0, 0, 0));
+            Raster::fillPolygon(star, rule, sink);
+            return count.count();
+        }});
+    }
+    {
+        auto image = std::make_shared<QImage>(2048, 2048, QImage::Format_RGB32);
+        CountSink count;
+        Raster::fillEllipse(QPoint(1024, 1024), 1000, 600, count);
+        list.append({"fill/ellipse", [=]
+        {
+            ImageSink sink(*image, image->rect(), qRgb(0, 0, 0));
+            Raster::fillEllipse(QPoint(1024, 1024), 1000, 600, sink);
+            return count.count();
+        }});
+    }
+    // 曲线：控制点数
+    for (int n : {4, 16, 64, 256})
+    {
+        QVector<QPoint> args;
+        for (int i = 0; i < n; ++i)
+            args.append(QPoint(i * 800 / n, i % 2 ? 100 : 700));
+        list.append({QString("curve/%1").arg(n), [=] { return Primitive::drawCurve(args).size(); }});
+    }
+    // 裁剪：直线完全在窗口内、完全在窗口外、穿过窗口
+    struct { const char *name; QPoint a, b; } lines[] =
+    {
+        {"inside", {200, 200}, {600, 500}}, {"outside", {0, 0}, {90, 700}}, {"crossing", {0, 50}, {800, 750}}
+    };
+    for (auto l : lines)
+    {
+        auto p = std::make_shared<Primitive>(QPen(), Primitive::Line, QVector<QPoint>{l.a, l.b});
+        list.append({QString("clip/line/%1").arg(l.name),
+                     [=] { return p->clip(QPoint(100, 100), QPoint(700, 600)).size(); }});
+    }
+    // 裁剪多边形和曲线：窗口内、窗口外、穿过窗口
+    struct { const char *name; QPoint offset; } windows[] =
+    {
+        {"inside", {0, 0}}, {"outside", {2000, 0}}, {"crossing", {300, 0}}
+    };
+    for (auto w : windows)
+        for (Primitive::Type type : {Primitive::Polygon, Primitive::Curve})
+        {
+            QVector<QPoint> args;
+            for (int i = 0; i < 16; ++i)
+                args.append(QPoint(qRound(400 + 200 * qCos(M_PI * i / 8)), qRound(350 + 200 * qSin(M_PI * i / 8))) + w.offset);
+            auto p = std::make_shared<Primitive>(QPen(), type, args);
+            list.append({QString("clip/%1/%2").arg(type == Primitive::Polygon ? "polygon" : "curve").arg(w.name),
+                         [=] { return p->clip(QPoint(100, 100), QPoint(700, 600)).size(); }});
+        }
+    // 裁剪椭圆：与窗口四条边界都相交
+    auto ellipse = std::make_shared<Primitive>(QPen(), Primitive::Ellipse, QVector<QPoint>{{400, 350}, {340, 290}});
+    list.append({"clip/ellipse/crossing", [=] { return ellipse->clip(QPoint(100, 100), QPoint(700, 600)).size(); }});
+    // 批量裁剪大量图元
+    auto scene = std::make_shared<QList<Primitive *>>();
+    for (int i = 0; i < 1000; ++i)
+    {
+        QPoint a((i * 37) % 800, (i * 91) % 700), b((i * 53) % 800, (i * 29) % 700);
+        Primitive::Type type = i % 3 == 0 ? Primitive::Line : i % 3 == 1 ? Primitive::Polygon : Primitive::Curve;
+        QVector<QPoint> args = {a, b, a + QPoint(40, 70), b + QPoint(-60, 20)};
+        scene->append(new Primitive(QPen(), type, type == Primitive::Line ? args.mid(0, 2) : args));
+    }
+    list.append({"clip/batch/1000", [=]
+    {
+        int n = 0;
+        foreach (const Clipper::Result &c, Clipper(QPoint(100, 100), QPoint(700, 600)).clip(*scene))
+            n += c.args.size();
+        return n;
+    }});
+    // 视口：10万条短线铺成的大画布，缩放倍数，耗时应与可见图元数成正比，缩得很小时每个图元只画一个点
+    auto field = std::make_shared<QList<Primitive *>>();
+    auto grid = std::make_shared<Grid>();
+    for (int i = 0; i < 100000; ++i)
+    {
+        QPoint a((i % 500) * 40, (i / 500) * 40);
+        field->append(new Primitive(QPen(), Primitive::Line, {a, a + QPoint(30, 30)}));
+        grid->insert(field->last());
+    }
+    auto canvas = std::make_shared<QImage>(1024, 768, QImage::Format_RGB32);
+    for (qreal scale : {1.0, 0.25, 1.0 / 32})
+    {
+        Viewport view;
+        view.zoom(scale, QPoint(0, 0));
+        list.append({QString("view/zoom/%1").arg(scale), [=]
+        {
+            QTransform t = view.transform();
+            QVector<Primitive *> visible = grid->query(view.toWorld(canvas->rect()));
+            foreach (Primitive *p, visible)
+                p->draw(canvas->bits(), canvas->bytesPerLine(), canvas->format(), canvas->rect(), t);
+            return visible.size();
+        }});
+    }
+    // 分块画布：8192x8192的海报上画跨越全图的粗线和填充圆，小预算时大部分块要换出到文件
+    auto poster = std::make_shared<QList<Primitive *>>();
+    for (int i = 0; i < 200; ++i)
+    {
+        QPoint a((i * 997) % 8192, (i * 613) % 8192), b((i * 331) % 8192, (i * 127) % 8192);
+        poster->append(new Primitive(QPen(Qt::black, 3), Primitive::Line, {a, b}));
+        poster->append(new Primitive(QPen(Qt::blue, 2), Primitive::Circle, {b, QPoint(300, 300)}));
+        poster->last()->setBrush(QBrush(Qt::yellow));
+    }
+    for (int mb : {16, 512})
+        list.append({QString("canvas/poster/%1MB").arg(mb), [=]
+        {
+            Canvas canvas(QSize(8192, 8192), qint64(mb) << 20);
+            canvas.draw(*poster);
+            return canvas.size().width() * canvas.size().height();
+        }});
+    return list;
+}
+
+struct Check
+{
+    QString name;					// 检查名称
+    std::function<QString()> run;	// 运行检查，通过时返回空串，否则返回失败原因
+};
+
+// 检查用的接收器：记录区域内每个像素被写入的次数，区域外的像素单独计数
+class HitSink
+{
+public:
+    explicit HitSink(QRect area) : _area(area), _hits(area.width() * area.height(), 0), _outside(0) {}
+    void plot(int x, int y) { span(y, x, x); }
+    void span(int y, int l, int r)
+    {
+        for (int x = l; x <= r; ++x)
+            if (_area.contains(x, y))
+                ++_hits[(y - _area.top()) * _area.width() + x - _area.left()];
+            else
+                ++_outside;
+    }
+    int hits(int x, int y) const { return _hits[(y - _area.top()) * _area.width() + x - _area.left()]; }
+    int outside() const { return _outside; }
+private:
+    QRect _area;		// 记录的区域
+    QVector<int> _hits;	// 每个像素的写入次数
+    int _outside;		// 区域外的像素数
+};
+
+// 逐点判断(x, y)是否在多边形内：统计左侧与第y条扫描线的交点，边覆盖[top, bottom)的扫描线。
+// 交点的算法与fillPolygon相同，恰好落在交点上的像素返回-1，两种结果都可以接受
+static int insidePolygon(const QVector<QPoint> &args, Qt::FillRule rule, int x, int y)
+{
+    int winding = 0, n = args.size();
+    for (int i = 0; i < n; ++i)
+    {
+        QPoint a = args[i], b = args[(i + 1) % n];
+        if (a.y() == b.y())
+            continue;
+        int dir = a.y() < b.y() ? 1 : -1;
+        if (dir < 0)
+            qSwap(a, b);
+        if (y < a.y() || y >= b.y())
+            continue;
+        qreal xi = qreal(a.x()) + (y - a.y()) * (qreal(b.x() - a.x()) / (b.y() - a.y()));
+        if (xi == x)
+            return -1;
+        if (xi < x)
+            winding += rule == Qt::WindingFill ? dir : 1;
+    }
+    return rule == Qt::WindingFill ? winding != 0 : (winding & 1);
+}
+
+static QVector<Check> checks()
+{
+    QVector<Check> list;
+    // 场景保存后读回：编辑器中的空图元、未画完的多边形和曲线、裁剪后只剩两个顶点的多边形都要能读回
+    list.append({"scene/roundtrip", []
+    {
+        Store store;
+        QPen pen(QColor(10, 20, 30), 3);
+        pen.setCapStyle(Qt::RoundCap);
+        store.create(pen, Primitive::Polygon, {});
+        store.create(pen, Primitive::Curve, {});
+        store.create(pen, Primitive::Polygon, {{5, 5}});
+        store.create(pen, Primitive::Polygon, {{5, 5}, {40, 9}})->setBrush(QBrush(Qt::red), Qt::WindingFill);
+        store.create(pen, Primitive::Curve, {{0, 0}, {10, 30}, {20, -4}});
+        store.create(QPen(Qt::blue, 1), Primitive::Line, {{-3, 4}, {100, 200}});
+        store.create(QPen(Qt::blue, 1), Primitive::Polygon, {{0, 0}, {50, 0}, {25, 40}})->setBrush(QBrush(Qt::green));
+        store.create(QPen(Qt::blue, 2), Primitive::Circle, {{60, 60}, {20, 20}})->setRanges({qMakePair(0.5, 2.0)});
+        store.create(QPen(Qt::blue, 2), Primitive::Ellipse, {{60, 60}, {30, 10}});
+        store.create(QPen(Qt::blue, 2), Primitive::Curve, {{0, 0}, {10, 30}, {20, -4}, {40, 8}, {50, 50}})->setRanges({qMakePair(0.25, 1.5)});
+        // 裁剪后多边形只剩一条边
+        Primitive *cut = store.create(pen, Primitive::Polygon, {{0, 0}, {200, 0}, {100, 100}});
+        foreach (const Clipper::Result &c, Clipper(QPoint(-10, -10), QPoint(300, 0)).clip({cut}))
+            if (c.where == Clipper::Clipped)
+                cut->setArgs(c.args);
+        QTemporaryFile file;
+        if (!file.open())
+            return QString("cannot create a temporary file");
+        file.close();
+        QString error;
+        Scene scene;
+        if (!Scene::save(file.fileName(), QSize(640, 480), store, &error) || !scene.load(file.fileName(), &error))
+            return error;
+        QList<Primitive *> expected;
+        foreach (Primitive *p, store.primitives())
+            if (!p->args().isEmpty())
+                expected.append(p);
+        if (scene.primitives().size() != expected.size())
+            return QString("%1 primitives read back, %2 saved").arg(scene.primitives().size()).arg(expected.size());
+        for (int i = 0; i < expected.size(); ++i)
+        {
+            Primitive *a = expected[i], *b = scene.primitives()[i];
+            bool same = a->type() == b->type() && a->args() == b->args() && a->pen() == b->pen() &&
+                    a->brush() == b->brush() && a->fillRule() == b->fillRule() && a->ranges().size() == b->ranges().size();
+            for (int j = 0; same && j < a->ranges().size(); ++j)
+                same = qAbs(a->ranges()[j].first - b->ranges()[j].first) < 1e-4 &&
+                        qAbs(a->ranges()[j].second - b->ranges()[j].second) < 1e-4;
+            if (!same)
+                return QString("primitive %1 differs after reading back").arg(i);
+        }
+        return QString();
+    }});
+    // 直接写入画布的接收器与兼容的点集输出相同：逐点光栅化的结果、缓存的扫描线和画布上的像素一致
+    list.append({"raster/sinks", []
+    {
+        std::mt19937 random(5);
+        QRect clip(16, 8, 96, 112);
+        for (int i = 0; i < 200; ++i)
+        {
+            Primitive::Type type = Primitive::Type(i % 5);
+            QVector<QPoint> args;
+            int n = type == Primitive::Circle || type == Primitive::Ellipse || type == Primitive::Line ? 2 : 3 + random() % 6;
+            for (int k = 0; k < n; ++k)
+                args.append(QPoint(random() % 160 - 16, random() % 160 - 16));
+            if (type == Primitive::Circle || type == Primitive::Ellipse)
+                args[1] = QPoint(random() % 60, random() % 60);
+            Primitive p(QPen(Qt::black, 1), type, args);
+            QVector<QPoint> traced;
+            VectorSink vector(traced);
+            p.trace(vector);
+            HitSink expected(QRect(-128, -128, 384, 384)), cached(QRect(-128, -128, 384, 384));
+            foreach (QPoint q, traced)
+                expected.plot(q.x(), q.y());
+            p.rasterize(cached);
+            CountSink count;
+            p.trace(count);
+            if (count.count() != traced.size())
+                return QString("case %1: %2 pixels counted, %3 traced").arg(i).arg(count.count()).arg(traced.size());
+            QImage image(128, 128, i % 2 ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::white);
+            ImageSink sink(image, clip, qRgb(0, 0, 0));
+            p.trace(sink);
+            for (int y = -128; y < 256; ++y)
+                for (int x = -128; x < 256; ++x)
+                {
+                    if ((expected.hits(x, y) > 0) != (cached.hits(x, y) > 0))
+                        return QString("case %1: cached spans differ at (%2, %3)").arg(i).arg(x).arg(y);
+                    if (image.rect().contains(x, y) &&
+                            (image.pixel(x, y) == qRgb(0, 0, 0)) != (clip.contains(x, y) && expected.hits(x, y) > 0))
+                        return QString("case %1: image differs at (%2, %3)").arg(i).arg(x).arg(y);
+                }
+        }
+        return QString();
+    }});
+    // 多边形填充与逐点判断比较，两种填充规则，凹多边形和自交多边形，每个像素只输出一次
+    list.append({"fill/polygon", []
+    {
+        std::mt19937 random(7);
+        QRect area(-4, -4, 72, 72);
+        for (int i = 0; i < 400; ++i)
+        {
+            QVector<QPoint> args;
+            int n = 3 + random() % 8;
+            for (int k = 0; k < n; ++k)
+                args.append(QPoint(random() % 64, random() % 64));
+            Qt::FillRule rule = i % 2 ? Qt::WindingFill : Qt::OddEvenFill;
+            HitSink hits(area);
+            Raster::fillPolygon(args, rule, hits);
+            if (hits.outside())
+                return QString("case %1: %2 pixels outside the polygon's bound").arg(i).arg(hits.outside());
+            for (int y = area.top(); y <= area.bottom(); ++y)
+                for (int x = area.left(); x <= area.right(); ++x)
+                {
+                    int inside = insidePolygon(args, rule, x, y);
+                    if (hits.hits(x, y) > 1)
+                        return QString("case %1: (%2, %3) filled twice").arg(i).arg(x).arg(y);
+                    if (inside >= 0 && hits.hits(x, y) != inside)
+                        return QString("case %1: (%2, %3) %4").arg(i).arg(x).arg(y).arg(inside ? "missing" : "filled outside");
+                }
+        }
+        return QString();
+    }});
+    // 椭圆填充与包围盒内x²ry² + y²rx² <= rx²ry²逐点比较，包括只填充部分行和半径为0的情况
+    list.append({"fill/ellipse", []
+    {
+        std::mt19937 random(11);
+        QRect area(-48, -48, 96, 96);
+        for (int i = 0; i < 600; ++i)
+        {
+            int rx = random() % 41, ry = i % 3 ? random() % 41 : rx;
+            QPoint c(random() % 9 - 4, random() % 9 - 4);
+            int top = i % 4 ? INT_MIN : int(random() % 90) - 45, bottom = i % 5 ? INT_MAX : int(random() % 90) - 45;
+            HitSink hits(area);
+            Raster::fillEllipse(c, rx, ry, hits, top, bottom);
+            if (hits.outside())
+                return QString("case %1: %2 pixels outside the ellipse's bound").arg(i).arg(hits.outside());
+            qint64 rx2 = qint64(rx) * rx, ry2 = qint64(ry) * ry;
+            for (int y = area.top(); y <= area.bottom(); ++y)
+                for (int x = area.left(); x <= area.right(); ++x)
+                {
+                    qint64 dx = x - c.x(), dy = y - c.y();
+                    int inside = y >= top && y <= bottom && qAbs(dx) <= rx && qAbs(dy) <= ry &&
+                            dx * dx * ry2 + dy * dy * rx2 <= rx2 * ry2;
+                    if (hits.hits(x, y) != inside)
+                        return QString("case %1: (%2, %3) filled %4 times").arg(i).arg(x).arg(y).arg(hits.hits(x, y));
+                }
+        }
+        return QString();
+    }});
+    // 圆弧和椭圆弧与整个图形比较：区间拼成整圈时与整个图形相同，单个区间只输出图形上的像素，
+    // 离区间端点较远的像素按角度判断必须输出或不输出，端点附近允许取整造成的差别
+    list.append({"raster/arcs", []
+    {
+        std::mt19937 random(13);
+        std::uniform_real_distribution<qreal> angle(0, 2 * M_PI);
+        QPoint c(3, -2);
+        QRect area(-128, -128, 256, 256);
+        for (int i = 0; i < 300; ++i)
+        {
+            bool circle = i % 3 == 0;
+            int rx = 1 + random() % 100, ry = circle ? rx : 1 + random() % 100;
+            auto trace = [&](HitSink &sink, const Ranges &ranges)
+            {
+                if (circle)
+                    Raster::circle(c, rx, sink, ranges);
+                else
+                    Raster::ellipse(c, rx, ry, sink, ranges);
+            };
+            HitSink full(area);
+            trace(full, Ranges());
+            // 随机切分整圈
+            QVector<qreal> cuts = {0, 2 * M_PI};
+            for (int k = random() % 12; k > 0; --k)
+                cuts.append(angle(random));
+            std::sort(cuts.begin(), cuts.end());
+            Ranges pieces;
+            for (int k = 0; k + 1 < cuts.size(); ++k)
+                pieces.append(qMakePair(cuts[k], cuts[k + 1]));
+            HitSink joined(area), arc(area);
+            trace(joined, pieces);
+            qreal a = angle(random), b = angle(random);
+            if (a > b)
+                qSwap(a, b);
+            trace(arc, {qMakePair(a, b)});
+            if (full.outside() || joined.outside() || arc.outside())
+                return QString("case %1: pixels outside the bound").arg(i);
+            // 相邻像素的参数角相差不超过1 / min(rx, ry)
+            qreal margin = 3.0 / qMin(rx, ry);
+            for (int y = area.top(); y <= area.bottom(); ++y)
+                for (int x = area.left(); x <= area.right(); ++x)
+                {
+                    bool on = full.hits(x, y) > 0;
+                    if ((joined.hits(x, y) > 0) != on)
+                        return QString("case %1: joined arcs differ at (%2, %3)").arg(i).arg(x).arg(y);
+                    if (!on)
+                    {
+                        if (arc.hits(x, y))
+                            return QString("case %1: arc pixel (%2, %3) is not on the shape").arg(i).arg(x).arg(y);
+                        continue;
+                    }
+                    qreal t = qAtan2(qreal(y - c.y()) / ry, qreal(x - c.x()) / rx);
+                    if (t < 0)
+                        t += 2 * M_PI;
+                    bool inside = t > a + margin && t < b - margin;
+                    bool outside = (t < a - margin || t > b + margin) && t + 2 * M_PI > b + margin && t - 2 * M_PI < a - margin;
+                    if ((inside && !arc.hits(x, y)) || (outside && arc.hits(x, y)))
+                        return QString("case %1: arc %2 (%3, %4)").arg(i).arg(inside ? "misses" : "includes").arg(x).arg(y);
+                }
+        }
+        return QString();
+    }});
+    // 像素格式特化的绘制函数与通用接收器逐像素比较：各种图元、画笔宽度、端点形状、待定变换和两种格式，
+    // 整个图元在clip内时走不裁剪的特化，跨过clip边界时走裁剪的特化
+    list.append({"draw/kernels", []
+    {
+        std::mt19937 random(17);
+        const Qt::PenCapStyle caps[] = {Qt::FlatCap, Qt::SquareCap, Qt::RoundCap};
+        const QTransform transforms[] = {QTransform(), QTransform::fromTranslate(7, -5), QTransform().rotate(20)};
+        const int widths[] = {1, 2, 3, 4, 5, 8};
+        for (int i = 0; i < 360; ++i)
+        {
+            Primitive::Type type = Primitive::Type(i % 5);
+            QVector<QPoint> args;
+            int n = type == Primitive::Polygon || type == Primitive::Curve ? 3 + random() % 4 : 2;
+            for (int k = 0; k < n; ++k)
+                args.append(QPoint(64 + random() % 128, 64 + random() % 128));
+            if (type == Primitive::Circle || type == Primitive::Ellipse)
+                args[1] = QPoint(1 + random() % 48, 1 + random() % 48);
+            QPen pen(QColor(200, 30, 90, i % 4 ? 255 : 128), widths[i / 5 % 6]);
+            pen.setCapStyle(caps[i / 30 % 3]);
+            Primitive p(pen, type, args);
+            if (type != Primitive::Line && type != Primitive::Curve)
+                p.setBrush(QBrush(QColor(10, 200, 40)), i % 2 ? Qt::WindingFill : Qt::OddEvenFill);
+            p.setTransform(transforms[i / 90 % 3]);
+            QImage::Format format = i % 2 ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+            for (QRect clip : {QRect(0, 0, 256, 256), QRect(30, 20, 150, 170)})
+            {
+                QImage kernel(256, 256, format), generic(256, 256, format);
+                kernel.fill(Qt::white);
+                generic.fill(Qt::white);
+                p.draw(kernel.bits(), kernel.bytesPerLine(), kernel.format(), clip);
+                if (p.filled())
+                {
+                    ImageSink sink(generic, clip, p.brush().color().rgba());
+                    p.fill(sink);
+                }
+                ImageSink sink(generic, clip, pen.color().rgba());
+                p.stroke(sink, clip);
+                for (int y = 0; y < 256; ++y)
+                    for (int x = 0; x < 256; ++x)
+                        if (kernel.pixel(x, y) != generic.pixel(x, y))
+                            return QString("case %1: clip %2 differs at (%3, %4)").arg(i).arg(clip.width()).arg(x).arg(y);
+            }
+        }
+        return QString();
+    }});
+    return list;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("cg-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks for the rasterizers and the clipper.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("filter", "Only run cases whose name contains this string.", "[filter]");
+    QCommandLineOption jsonOption("json", "Print one JSON object per case.");
+    QCommandLineOption timeOption("time", "Minimum time per case in milliseconds (default: 200).", "ms", "200");
+    QCommandLineOption checkOption("check", "Run the correctness checks instead of the benchmarks.");
+    parser.addOption(jsonOption);
+    parser.addOption(timeOption);
+    parser.addOption(checkOption);
+    parser.process(a);
+
+    QString filter = parser.positionalArguments().value(0);
+    if (parser.isSet(checkOption))
+    {
+        QTextStream out(stdout);
+        int failed = 0;
+        foreach (const Check &c, checks())
+        {
+            if (!c.name.contains(filter))
+                continue;
+            QString message = c.run();
+            out << (message.isEmpty() ? "ok   " : "FAIL ") << c.name << (message.isEmpty() ? "" : ": " + message) << "\n";
+            out.flush();
+            failed += !message.isEmpty();
+        }
+        return failed ? 1 : 0;
+    }
+    qint64 minTime = qMax(parser.value(timeOption).toInt(), 1);
+    bool json = parser.isSet(jsonOption);
+
+    QTextStream out(stdout);
+    if (!json)
+        out << QString("%1 %2 %3 %4\n").arg("case", -24).arg("ns/call", 12).arg("Mpixels/s", 12).arg("allocs/call", 12);
+    foreach (const Case &c, cases())
+    {
+        if (!c.name.contains(filter))
+            continue;
+        Result r = measure(c, minTime);
+        QString allocs = r.allocs < 0 ? QString() : QString::number(r.allocs, 'f', 2);
+        if (json)
+            out << QString("{\"case\":\"%1\",\"iterations\":%2,\"ns\":%3,\"pixels_per_s\":%4,\"allocs\":%5}\n")
+                   .arg(c.name).arg(r.iterations).arg(r.ns, 0, 'f', 1).arg(r.pixels, 0, 'f', 0)
+                   .arg(allocs.isEmpty() ? "null" : allocs);
+        else
+            out << QString("%1 %2 %3 %4\n").arg(c.name, -24).arg(r.ns, 12, 'f', 1)
+                   .arg(r.pixels / 1e6, 12, 'f', 1).arg(allocs.isEmpty() ? "n/a" : allocs, 12);
+        out.flush();
+    }
+    return 0;
+}
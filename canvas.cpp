@@ -0,0 +1,238 @@
+#include "canvas.h"
+#include "profiler.h"
+#include "primitive.h"
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+
+static const int tileWords = Canvas::tileSize * Canvas::tileSize;	// 每块的像素数
+static const qint64 tileBytes = qint64(tileWords) * 4;			// 每块的字节数
+
+static bool fail(QString *error, const QString &message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+Canvas::Canvas(QSize size, qint64 budget, QRgb background)
+    : Canvas(QRect(QPoint(0, 0), size), budget, background)
+{
+
+}
+
+Canvas::Canvas(QRect area, qint64 budget, QRgb background)
+    : _origin(area.topLeft()), _size(area.size().expandedTo(QSize(0, 0))), _background(background | 0xff000000), _clock(0), _map(nullptr), _ok(true)
+{
+    _columns = (_size.width() + tileSize - 1) / tileSize;
+    _rows = (_size.height() + tileSize - 1) / tileSize;
+    int tiles = _columns * _rows;
+    // 至少能缓存一行块，保存时逐行读取不会反复换入换出
+    int count = int(qMin<qint64>(qMax<qint64>(budget / tileBytes, _columns), tiles));
+    _memory.resize(count * tileWords);
+    _owner.fill(-1, count);
+    _stamp.fill(0, count);
+    _dirty.fill(false, count);
+    _slot.fill(-1, tiles);
+    _spilled.fill(false, tiles);
+}
+
+Canvas::~Canvas()
+{
+    if (_map)
+        _file.unmap(_map);
+}
+
+QSize Canvas::size() const
+{
+    return _size;
+}
+
+QRect Canvas::rect() const
+{
+    return QRect(_origin, _size);
+}
+
+QRgb Canvas::background() const
+{
+    return _background;
+}
+
+bool Canvas::ok() const
+{
+    return _ok;
+}
+
+quint32 *Canvas::pixel(int x, int y)
+{
+    x -= _origin.x();
+    y -= _origin.y();
+    return tile(y / tileSize * _columns + x / tileSize, true) + y % tileSize * tileSize + x % tileSize;
+}
+
+quint32 *Canvas::tile(int index, bool write)
+{
+    int s = _slot[index];
+    if (s < 0)
+    {
+        // 优先使用空闲槽，否则换出最久未使用的块
+        s = 0;
+        for (int i = 0; i < _owner.size(); ++i)
+        {
+            if (_owner[i] < 0)
+            {
+                s = i;
+                break;
+            }
+            if (_stamp[i] < _stamp[s])
+                s = i;
+        }
+        evict(s);
+        quint32 *pixels = _memory.data() + qint64(s) * tileWords;
+        if (!_spilled[index] || !unspill(index, pixels))
+            std::fill(pixels, pixels + tileWords, _background);
+        _owner[s] = index;
+        _slot[index] = s;
+    }
+    _stamp[s] = ++_clock;
+    if (write)
+        _dirty[s] = true;
+    return _memory.data() + qint64(s) * tileWords;
+}
+
+void Canvas::evict(int slot)
+{
+    int index = _owner[slot];
+    if (index < 0)
+        return;
+    // 没有修改过的块与文件中或背景色一致，不必写回
+    if (_dirty[slot])
+        _spilled[index] = spill(index, _memory.constData() + qint64(slot) * tileWords);
+    _dirty[slot] = false;
+    _slot[index] = -1;
+    _owner[slot] = -1;
+}
+
+bool Canvas::spill(int index, const quint32 *pixels)
+{
+    ProfileScope scope("spill");
+    if (!_ok)
+        return false;
+    if (!_file.isOpen())
+    {
+        // 文件按整张画布的大小创建，没写过的部分是稀疏的，不占用磁盘
+        qint64 total = qint64(_columns) * _rows * tileBytes;
+        if (!_file.open() || !_file.resize(total))
+            return _ok = false;
+        _map = _file.map(0, total);
+    }
+    if (_map)
+    {
+        memcpy(_map + index * tileBytes, pixels, size_t(tileBytes));
+        return true;
+    }
+    if (!_file.seek(index * tileBytes) ||
+            _file.write(reinterpret_cast<const char *>(pixels), tileBytes) != tileBytes)
+        return _ok = false;
+    return true;
+}
+
+bool Canvas::unspill(int index, quint32 *pixels)
+{
+    ProfileScope scope("unspill");
+    if (_map)
+    {
+        memcpy(pixels, _map + index * tileBytes, size_t(tileBytes));
+        return true;
+    }
+    if (!_file.seek(index * tileBytes) ||
+            _file.read(reinterpret_cast<char *>(pixels), tileBytes) != tileBytes)
+        return _ok = false;
+    return true;
+}
+
+void Canvas::draw(const QList<Primitive *> &primitives)
+{
+    // 按图元顺序直接绘制时，跨越整张画布的图元会不断换出刚用过的块。
+    // 改为把画布分成缓存能容纳的若干行块，每带内按顺序绘制与之相交的图元，绘制顺序不变
+    int band = qMax(_owner.size() / qMax(_columns, 1), 1) * tileSize;
+    for (int top = 0; top < _size.height(); top += band)
+    {
+        QRect clip(_origin.x(), _origin.y() + top, _size.width(), qMin(band, _size.height() - top));
+        foreach (Primitive *p, primitives)
+            if (p->rect().intersects(clip))
+                p->draw(*this, clip);
+    }
+}
+
+void Canvas::drawImage(QPoint pos, const QImage &image)
+{
+    QImage source = image.convertToFormat(QImage::Format_RGB32);
+    QRect r = QRect(pos, source.size()) & rect();
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(source.constScanLine(y - pos.y())) - pos.x();
+        for (int x = r.left(); x <= r.right(); )
+        {
+            int end = qMin(r.right(), x + tileSize - 1 - (x - _origin.x()) % tileSize);
+            memcpy(pixel(x, y), line + x, size_t(end - x + 1) * 4);
+            x = end + 1;
+        }
+    }
+}
+
+bool Canvas::save(const QString &file, QString *error)
+{
+    // 24位BMP从最后一行开始存放，每行补齐到4字节，文件大小字段只有32位
+    int w = _size.width(), h = _size.height();
+    qint64 rowBytes = (qint64(w) * 3 + 3) & ~3, total = 54 + rowBytes * h;
+    if (w <= 0 || h <= 0 || total > 0xffffffffLL || rowBytes > (1 << 30))
+        return fail(error, QString("%1: %2x%3 is too large for BMP").arg(file).arg(w).arg(h));
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly))
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    ProfileScope scope("encode");
+    uchar header[54] = {'B', 'M'};
+    qToLittleEndian<quint32>(quint32(total), header + 2);
+    qToLittleEndian<quint32>(54, header + 10);
+    qToLittleEndian<quint32>(40, header + 14);
+    qToLittleEndian<qint32>(w, header + 18);
+    qToLittleEndian<qint32>(h, header + 22);
+    qToLittleEndian<quint16>(1, header + 26);
+    qToLittleEndian<quint16>(24, header + 28);
+    qToLittleEndian<quint32>(quint32(rowBytes * h), header + 34);
+    QByteArray buffer(reinterpret_cast<const char *>(header), sizeof(header));
+    bool ok = true;
+    QByteArray row(int(rowBytes), 0);
+    for (int y = h - 1; y >= 0; --y)
+    {
+        uchar *out = reinterpret_cast<uchar *>(row.data());
+        for (int tx = 0; tx < _columns; ++tx)
+        {
+            int index = y / tileSize * _columns + tx, n = qMin(tileSize, w - tx * tileSize);
+            // 没写过的块直接输出背景色，不换入
+            const quint32 *line = _slot[index] < 0 && !_spilled[index] ? nullptr :
+                    tile(index, false) + y % tileSize * tileSize;
+            for (int i = 0; i < n; ++i, out += 3)
+            {
+                quint32 c = line ? line[i] : _background;
+                out[0] = uchar(c);
+                out[1] = uchar(c >> 8);
+                out[2] = uchar(c >> 16);
+            }
+        }
+        buffer += row;
+        if (buffer.size() >= (1 << 20))
+        {
+            ok = f.write(buffer) == buffer.size() && ok;
+            buffer.clear();
+        }
+    }
+    ok = f.write(buffer) == buffer.size() && ok;
+    scope.addPixels(qint64(w) * h);
+    if (!ok)
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    if (!_ok)
+        return fail(error, QString("%1: tile swap file: %2").arg(file).arg(_file.errorString()));
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <QPen>
+#include <QRect>
+#include <QSize>
+#include <QImage>
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QTemporaryFile>
+#include <algorithm>
+
+class Primitive;
+
+// 分块画布：像素按256x256的RGB32块存放，内存中只缓存最近使用的块，超出预算的块换出到内存映射的临时文件，
+// 未写过的块是背景色，不占用内存也不占用文件。用于绘制和导出超过内存的大图，保存时按行从各块读取像素。
+// 画布可以对应世界坐标中任意位置的矩形，接口中的坐标都是世界坐标，左上角是第一个像素
+class Canvas
+{
+public:
+    static constexpr int tileSize = 256;	// 块的边长
+    explicit Canvas(QSize size, qint64 budget = 64 << 20, QRgb background = 0xffffffff);	// 从原点开始的画布
+    explicit Canvas(QRect area, qint64 budget = 64 << 20, QRgb background = 0xffffffff);	// 覆盖世界坐标中area的画布
+    ~Canvas();
+    QSize size() const;			// 画布大小
+    QRect rect() const;			// 画布在世界坐标中的区域
+    QRgb background() const;	// 背景色
+    quint32 *pixel(int x, int y);	// 取得像素所在块的指针，同一块内同一行的像素连续存放，块被标记为已修改
+    void draw(const QList<Primitive *> &primitives);	// 按绘制顺序画出图元，分带进行，每块只换入一次
+    void drawImage(QPoint pos, const QImage &image);	// 把图片复制到画布的pos处
+    bool save(const QString &file, QString *error = nullptr);	// 按行输出为24位BMP，不生成整张图片
+    bool ok() const;			// 换出文件是否一直可用，失败后换出的块丢失为背景色
+private:
+    Q_DISABLE_COPY(Canvas)
+    quint32 *tile(int index, bool write);	// 取得块的像素，不在缓存中时换入
+    void evict(int slot);		// 把缓存槽中的块换出
+    bool spill(int index, const quint32 *pixels);	// 把块写入换出文件
+    bool unspill(int index, quint32 *pixels);		// 从换出文件读回块
+    QPoint _origin;				// 第一个像素的世界坐标
+    QSize _size;
+    int _columns, _rows;		// 块的列数和行数
+    QRgb _background;
+    QVector<quint32> _memory;	// 缓存槽的像素，每槽一个块
+    QVector<int> _owner;		// 缓存槽中的块序号，-1表示空闲
+    QVector<quint64> _stamp;	// 缓存槽最近使用的时刻，换出最早使用的槽
+    QVector<bool> _dirty;		// 缓存槽换入后是否被修改
+    QVector<int> _slot;			// 块所在的缓存槽，-1表示不在缓存中
+    QVector<bool> _spilled;		// 块是否已写入换出文件
+    quint64 _clock;				// 缓存访问计数
+    QTemporaryFile _file;		// 换出文件，第一次换出时创建，每块在文件中有固定位置
+    uchar *_map;				// 换出文件的内存映射，映射失败时改用读写文件
+    bool _ok;
+};
+
+// 把像素写入分块画布，与ImageSink一样一像素宽并裁剪，整行区间在块边界处拆开
+class CanvasSink
+{
+public:
+    CanvasSink(Canvas &canvas, QRgb color, QRect clip)
+        : _canvas(canvas), _color(color | 0xff000000), _left(canvas.rect().left())
+    {
+        clip &= canvas.rect();
+        _l = clip.left();
+        _t = clip.top();
+        _r = clip.right();
+        _b = clip.bottom();
+    }
+    void plot(int x, int y) { fill(y, x, x); }
+    void span(int y, int l, int r) { fill(y, l, r); }
+    void fill(int y, int l, int r)
+    {
+        if (y < _t || y > _b)
+            return;
+        l = qMax(l, _l);
+        r = qMin(r, _r);
+        while (l <= r)
+        {
+            int end = qMin(r, l + Canvas::tileSize - 1 - (l - _left) % Canvas::tileSize);
+            quint32 *line = _canvas.pixel(l, y);
+            std::fill(line, line + end - l + 1, _color);
+            l = end + 1;
+        }
+    }
+private:
+    Canvas &_canvas;
+    int _l, _t, _r, _b;	// 裁剪区域
+    quint32 _color;		// 画笔颜色
+    int _left;			// 画布左边界，块边界由此算起
+};
+
+#endif // CANVAS_H
@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks for the rasterizers and the clipper, plus correctness checks (--check)
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT       -= widgets
+
+TARGET = cg-bench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+SOURCES += \
+        bench.cpp \
+    primitive.cpp \
+    canvas.cpp \
+    store.cpp \
+    clipper.cpp \
+    grid.cpp \
+    spans.cpp \
+    viewport.cpp \
+    scene.cpp \
+    profiler.cpp
+
+HEADERS += \
+    primitive.h \
+    canvas.h \
+    store.h \
+    clipper.h \
+    grid.h \
+    raster.h \
+    spans.h \
+    viewport.h \
+    scene.h \
+    stroker.h \
+    profiler.h
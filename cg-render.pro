@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Headless batch renderer, shares the primitives with CG
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+QT       -= widgets
+
+TARGET = cg-render
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+SOURCES += \
+        render.cpp \
+    scene.cpp \
+    exporter.cpp \
+    primitive.cpp \
+    canvas.cpp \
+    store.cpp \
+    clipper.cpp \
+    grid.cpp \
+    spans.cpp \
+    profiler.cpp
+
+HEADERS += \
+    scene.h \
+    exporter.h \
+    primitive.h \
+    canvas.h \
+    store.h \
+    clipper.h \
+    grid.h \
+    raster.h \
+    spans.h \
+    stroker.h \
+    profiler.h
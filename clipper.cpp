@@ -0,0 +1,305 @@
+#include "clipper.h"
+
+// 按一条窗口边界收缩可见参数区间，p为方向分量，q为起点到边界的距离，用条件选择代替分支
+static inline void boundary(qreal p, qreal q, qreal &lo, qreal &hi)
+{
+    qreal r = q / p;
+    lo = p < 0 ? qMax(lo, r) : (p == 0 && q < 0 ? 2 : lo);
+    hi = p > 0 ? qMin(hi, r) : hi;
+}
+
+Ranges Clipper::intersect(const Ranges &a, const Ranges &b)
+{
+    Ranges result;
+    int i = 0, j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        qreal lo = qMax(a[i].first, b[j].first), hi = qMin(a[i].second, b[j].second);
+        if (lo < hi)
+            result.append(qMakePair(lo, hi));
+        if (a[i].second < b[j].second)
+            ++i;
+        else
+            ++j;
+    }
+    return result;
+}
+
+Clipper::Clipper(QPoint lt, QPoint rb)
+    : _l(qMin(lt.x(), rb.x())), _t(qMin(lt.y(), rb.y())), _r(qMax(lt.x(), rb.x())), _b(qMax(lt.y(), rb.y()))
+{
+
+}
+
+QVector<Clipper::Result> Clipper::clip(const QList<Primitive *> &primitives)
+{
+    QVector<Result> results;
+    results.reserve(primitives.size());
+    _lines.clear();
+    _x1.clear();
+    _y1.clear();
+    _x2.clear();
+    _y2.clear();
+    _polygons.clear();
+    _start.clear();
+    _x.clear();
+    _y.clear();
+    foreach (Primitive *p, primitives)
+    {
+        // 参数直接读取存储中的共享数组，只有裁剪后仍需写回的圆、椭圆和曲线复制一份
+        Result c = {p, Inside, QVector<QPoint>(), p->ranges()};
+        Points a = p->argPoints();
+        QRect r = p->rect();
+        if (a.isEmpty() || (r.left() >= _l && r.right() <= _r && r.top() >= _t && r.bottom() <= _b))
+        {
+            results.append(c);
+            continue;
+        }
+        if (r.right() < _l || r.left() > _r || r.bottom() < _t || r.top() > _b)
+        {
+            c.where = Outside;
+            c.ranges.clear();
+            results.append(c);
+            continue;
+        }
+        // 与窗口边界相交的图元先收集起来，最后统一裁剪
+        c.where = Clipped;
+        switch (p->type())
+        {
+        case Primitive::Line:
+            _lines.append(results.size());
+            _x1.append(a[0].x());
+            _y1.append(a[0].y());
+            _x2.append(a[1].x());
+            _y2.append(a[1].y());
+            break;
+        case Primitive::Polygon:
+            _polygons.append(results.size());
+            _start.append(_x.size());
+            foreach (QPoint q, a)
+            {
+                _x.append(q.x());
+                _y.append(q.y());
+            }
+            break;
+        case Primitive::Curve:
+        case Primitive::Circle:
+        case Primitive::Ellipse:
+        {
+            c.args = a.toVector();
+            Ranges found;
+            qreal end;
+            if (p->type() == Primitive::Curve)
+            {
+                if (a.size() < 4)
+                    break;
+                found = clipCurve(a);
+                end = a.size() - 3;
+            }
+            else
+            {
+                qreal rx = qAbs(a[1].x()), ry = qAbs(a[1].y());
+                if (p->type() == Primitive::Circle)
+                    rx = ry = qMin(rx, ry);
+                found = clipEllipse(a[0], qMax(rx, 1.0), qMax(ry, 1.0));
+                end = 2 * M_PI;
+            }
+            if (!c.ranges.isEmpty())
+                found = intersect(found, c.ranges);
+            if (found.isEmpty())
+            {
+                c.where = Outside;
+                c.args.clear();
+            }
+            else if (c.ranges.isEmpty() && found.size() == 1 && found[0].first <= 0 && found[0].second >= end)
+            {
+                // 控制点凸包或包围盒越过窗口但图元本身在窗口内
+                c.where = Inside;
+                c.args.clear();
+                found.clear();
+            }
+            c.ranges = found;
+            break;
+        }
+        }
+        results.append(c);
+    }
+    _start.append(_x.size());
+    clipLines(results);
+    clipPolygons(results);
+    return results;
+}
+
+void Clipper::clipLines(QVector<Result> &results)
+{
+    int n = _lines.size();
+    QVector<qreal> t0(n), t1(n);
+    const qreal *x1 = _x1.constData(), *y1 = _y1.constData(), *x2 = _x2.constData(), *y2 = _y2.constData();
+    qreal *a = t0.data(), *b = t1.data();
+    for (int i = 0; i < n; ++i)
+    {
+        qreal dx = x2[i] - x1[i], dy = y2[i] - y1[i], lo = 0, hi = 1;
+        boundary(-dx, x1[i] - _l, lo, hi);
+        boundary(dx, _r - x1[i], lo, hi);
+        boundary(-dy, y1[i] - _t, lo, hi);
+        boundary(dy, _b - y1[i], lo, hi);
+        a[i] = lo;
+        b[i] = hi;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        Result &c = results[_lines[i]];
+        if (a[i] > b[i])
+        {
+            c.where = Outside;
+            c.args.clear();
+            continue;
+        }
+        qreal dx = x2[i] - x1[i], dy = y2[i] - y1[i];
+        c.args = {QPoint(qRound(x1[i] + a[i] * dx), qRound(y1[i] + a[i] * dy)),
+                  QPoint(qRound(x1[i] + b[i] * dx), qRound(y1[i] + b[i] * dy))};
+    }
+}
+
+void Clipper::clipPolygons(QVector<Result> &results)
+{
+    // 窗口内侧的有向距离为 sx * x + sy * y + d，依次为左、右、上、下边界
+    const qreal planes[4][3] = {{1, 0, -_l}, {-1, 0, _r}, {0, 1, -_t}, {0, -1, _b}};
+    QVector<qreal> x, y;
+    QVector<int> start;
+    for (auto plane : planes)
+    {
+        x.clear();
+        y.clear();
+        start.clear();
+        x.reserve(_x.size() + _polygons.size() * 2);
+        y.reserve(_y.size() + _polygons.size() * 2);
+        for (int j = 0; j < _polygons.size(); ++j)
+        {
+            start.append(x.size());
+            int s = _start[j], e = _start[j + 1];
+            for (int i = s; i < e; ++i)
+            {
+                int k = i == s ? e - 1 : i - 1;
+                qreal dc = plane[0] * _x[i] + plane[1] * _y[i] + plane[2];
+                qreal dp = plane[0] * _x[k] + plane[1] * _y[k] + plane[2];
+                if ((dc >= 0) != (dp >= 0))
+                {
+                    qreal t = dp / (dp - dc);
+                    x.append(_x[k] + (_x[i] - _x[k]) * t);
+                    y.append(_y[k] + (_y[i] - _y[k]) * t);
+                }
+                if (dc >= 0)
+                {
+                    x.append(_x[i]);
+                    y.append(_y[i]);
+                }
+            }
+        }
+        start.append(x.size());
+        _x.swap(x);
+        _y.swap(y);
+        _start.swap(start);
+    }
+    for (int j = 0; j < _polygons.size(); ++j)
+    {
+        Result &c = results[_polygons[j]];
+        c.args.clear();
+        for (int i = _start[j]; i < _start[j + 1]; ++i)
+        {
+            QPoint a(qRound(_x[i]), qRound(_y[i]));
+            if (c.args.isEmpty() || c.args.last() != a)
+                c.args.append(a);
+        }
+        if (c.args.size() > 1 && c.args.first() == c.args.last())
+            c.args.removeLast();
+        if (c.args.size() < 2)
+        {
+            c.where = Outside;
+            c.args.clear();
+        }
+    }
+}
+
+Ranges Clipper::clipCurve(Points args) const
+{
+    Ranges ranges;
+    QPointF b[4];
+    for (int i = 3; i < args.size(); ++i)
+    {
+        Raster::bezier(args, i, b);
+        visible(b, i - 3, i - 2, ranges, 16);
+    }
+    return ranges;
+}
+
+void Clipper::visible(const QPointF b[4], qreal t0, qreal t1, Ranges &ranges, int depth) const
+{
+    // 控制点凸包完全在窗口内或窗口外时直接判定，否则在中点细分
+    qreal minx = b[0].x(), maxx = minx, miny = b[0].y(), maxy = miny;
+    for (int i = 1; i < 4; ++i)
+    {
+        minx = qMin(minx, b[i].x());
+        maxx = qMax(maxx, b[i].x());
+        miny = qMin(miny, b[i].y());
+        maxy = qMax(maxy, b[i].y());
+    }
+    if (maxx < _l || minx > _r || maxy < _t || miny > _b)
+        return;
+    bool inside = minx >= _l && maxx <= _r && miny >= _t && maxy <= _b;
+    if (!inside)
+    {
+        if (depth > 0 && (maxx - minx > 0.5 || maxy - miny > 0.5))
+        {
+            QPointF l[4], r[4];
+            Raster::split(b, l, r);
+            qreal m = (t0 + t1) / 2;
+            visible(l, t0, m, ranges, depth - 1);
+            visible(r, m, t1, ranges, depth - 1);
+            return;
+        }
+        // 足够小的一段按中点是否在窗口内决定
+        QPointF c = (b[0] + b[3]) / 2;
+        if (c.x() < _l || c.x() > _r || c.y() < _t || c.y() > _b)
+            return;
+    }
+    if (!ranges.isEmpty() && ranges.last().second >= t0)
+        ranges.last().second = t1;
+    else
+        ranges.append(qMakePair(t0, t1));
+}
+
+Ranges Clipper::clipEllipse(QPoint c, qreal rx, qreal ry) const
+{
+    // 椭圆上的点为 (cx + rx cos t, cy + ry sin t)，求出与四条窗口边界的交点，
+    // 相邻交点之间的圆弧整体在窗口内或窗口外，按中点判定，相切的点同样作为分界
+    QVector<qreal> cuts = {0, 2 * M_PI};
+    auto cross = [&](qreal v, bool sine)
+    {
+        if (v < -1 || v > 1)
+            return;
+        qreal a = sine ? qAsin(v) : qAcos(v);
+        cuts.append(sine ? (a < 0 ? a + 2 * M_PI : a) : a);
+        cuts.append(sine ? M_PI - a : 2 * M_PI - a);
+    };
+    cross((_l - c.x()) / rx, false);
+    cross((_r - c.x()) / rx, false);
+    cross((_t - c.y()) / ry, true);
+    cross((_b - c.y()) / ry, true);
+    std::sort(cuts.begin(), cuts.end());
+    Ranges ranges;
+    for (int i = 1; i < cuts.size(); ++i)
+    {
+        qreal t0 = cuts[i - 1], t1 = cuts[i], m = (t0 + t1) / 2;
+        if (t0 >= t1)
+            continue;
+        qreal x = c.x() + rx * qCos(m), y = c.y() + ry * qSin(m);
+        if (x < _l || x > _r || y < _t || y > _b)
+            continue;
+        if (!ranges.isEmpty() && ranges.last().second >= t0)
+            ranges.last().second = t1;
+        else
+            ranges.append(qMakePair(t0, t1));
+    }
+    return ranges;
+}
@@ -0,0 +1,41 @@
+#ifndef CLIPPER_H
+#define CLIPPER_H
+
+#include "primitive.h"
+#include <QList>
+#include <QPoint>
+#include <QVector>
+
+// 批量裁剪：包围盒完全在窗口内或窗口外的图元直接判定，其余图元的边按结构数组集中存放，
+// 直线用Liang-Barsky算法在一遍无分支的循环中求出可见参数，多边形用Sutherland-Hodgman算法
+// 对所有多边形逐条窗口边界处理，曲线逐段细分求出窗口内的参数区间，圆和椭圆解析求出与窗口边界的交点，
+// 得到可见圆弧的参数角区间
+class Clipper
+{
+public:
+    enum Where { Inside, Outside, Clipped };
+    struct Result
+    {
+        Primitive *primitive;	// 图元
+        Where where;			// 图元与窗口的关系
+        QVector<QPoint> args;	// 裁剪后的参数，只有与窗口相交时才有，完全在窗口内或窗口外时为空
+        Ranges ranges;			// 裁剪后曲线可见的参数区间，或圆和椭圆可见的参数角区间
+    };
+    Clipper(QPoint lt, QPoint rb);
+    QVector<Result> clip(const QList<Primitive *> &primitives);	// 裁剪所有图元，结果与图元一一对应
+    Ranges clipEllipse(QPoint c, qreal rx, qreal ry) const;	// 求椭圆在窗口内的参数角区间
+    static Ranges intersect(const Ranges &a, const Ranges &b);	// 两组有序参数区间的交集
+private:
+    void clipLines(QVector<Result> &results);		// 批量裁剪直线
+    void clipPolygons(QVector<Result> &results);	// 批量裁剪多边形
+    Ranges clipCurve(Points args) const;	// 求曲线在窗口内的参数区间
+    void visible(const QPointF b[4], qreal t0, qreal t1, Ranges &ranges, int depth) const;
+    qreal _l, _t, _r, _b;				// 窗口边界
+    QVector<int> _lines;				// 各直线对应的结果
+    QVector<qreal> _x1, _y1, _x2, _y2;	// 直线端点
+    QVector<int> _polygons;				// 各多边形对应的结果
+    QVector<int> _start;				// 各多边形第一个顶点的位置，最后一项为顶点总数
+    QVector<qreal> _x, _y;				// 多边形顶点
+};
+
+#endif // CLIPPER_H
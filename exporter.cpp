@@ -0,0 +1,252 @@
+#include "exporter.h"
+#include <QColor>
+#include <QFileInfo>
+
+static const qreal kappa = 0.5522847498;	// 用三次贝塞尔曲线近似四分之一椭圆弧的控制点系数
+
+static QByteArray num(qreal v)
+{
+    return QByteArray::number(v, 'g', 8);
+}
+
+Exporter::Exporter(Format format)
+    : _format(format), _written(0), _stream(0), _ok(false)
+{
+
+}
+
+Exporter::~Exporter()
+{
+    if (_file.isOpen())
+        end();
+}
+
+bool Exporter::begin(const QString &file, QSize size, QString *error)
+{
+    _file.setFileName(file);
+    _ok = _file.open(QIODevice::WriteOnly);
+    if (!_ok)
+    {
+        if (error)
+            *error = QString("%1: %2").arg(file).arg(_file.errorString());
+        return false;
+    }
+    _buffer.clear();
+    _written = 0;
+    _size = size;
+    QByteArray w = num(size.width()), h = num(size.height());
+    if (_format == Svg)
+    {
+        // 像素坐标指向像素左上角，平移半个像素使线条落在像素中心
+        put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" + w + "\" height=\"" + h +
+            "\" viewBox=\"0 0 " + w + " " + h + "\">\n"
+            "<g fill=\"none\" stroke-linecap=\"square\" stroke-linejoin=\"miter\" transform=\"translate(0.5 0.5)\">\n");
+    }
+    else
+    {
+        // 单页文档，内容流长度写在流之后的对象中，这样内容可以直接流式输出
+        _objects.clear();
+        put("%PDF-1.4\n");
+        _objects.append(offset());
+        put("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+        _objects.append(offset());
+        put("2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+        _objects.append(offset());
+        // 内容只用路径操作，不引用字体和图片，资源字典为空，但页面对象必须带有这一项
+        put("3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + w + " " + h + "] /Resources << >> /Contents 4 0 R >>\nendobj\n");
+        _objects.append(offset());
+        put("4 0 obj\n<< /Length 5 0 R >>\nstream\n");
+        _stream = offset();
+        // 翻转纵轴使原点位于左上角，并平移到像素中心
+        put("1 0 0 -1 0.5 " + num(size.height() - 0.5) + " cm 2 J 0 j\n");
+    }
+    return true;
+}
+
+void Exporter::write(Primitive *p)
+{
+    Points args = p->argPoints();
+    Ranges ranges = p->ranges();
+    Primitive::Type type = p->type();
+    if (args.isEmpty() || (type == Primitive::Curve && args.size() < 4))
+        return;
+    QPen pen = p->pen();
+    QColor color = pen.color();
+    QByteArray width = num(qMax(pen.width(), 1));
+    bool round = pen.capStyle() == Qt::RoundCap;
+    bool filled = p->filled(), winding = p->fillRule() == Qt::WindingFill;
+    QColor fill = p->brush().color();
+    if (_format == Svg)
+    {
+        QByteArray stroke = (filled ? "\" fill=\"" + fill.name().toLatin1() + "\" fill-rule=\"" +
+                             (winding ? "nonzero" : "evenodd") : QByteArray()) +
+                "\" stroke=\"" + color.name().toLatin1() + "\" stroke-width=\"" + width +
+                (round ? "\" stroke-linecap=\"round\" stroke-linejoin=\"round" : "") + "\"/>\n";
+        QPoint c = args[0];
+        if (type == Primitive::Circle && ranges.isEmpty())
+            put("<circle cx=\"" + num(c.x()) + "\" cy=\"" + num(c.y()) +
+                "\" r=\"" + num(qMin(qAbs(args[1].x()), qAbs(args[1].y()))) + stroke);
+        else if (type == Primitive::Ellipse && ranges.isEmpty())
+            put("<ellipse cx=\"" + num(c.x()) + "\" cy=\"" + num(c.y()) +
+                "\" rx=\"" + num(qMax(qAbs(args[1].x()), 1)) + "\" ry=\"" + num(qMax(qAbs(args[1].y()), 1)) + stroke);
+        else
+            put("<path d=\"" + path(type, args, ranges) + stroke);
+    }
+    else
+    {
+        // 填充的图元用B或B*同时填充和描边，填充规则对应非零环绕和奇偶
+        QByteArray paint = filled ? (winding ? "B" : "B*") : "S";
+        put(QByteArray(round ? "q 1 J 1 j " : "") + num(color.redF()) + " " + num(color.greenF()) + " " +
+            num(color.blueF()) + " RG " + (filled ? num(fill.redF()) + " " + num(fill.greenF()) + " " +
+            num(fill.blueF()) + " rg " : QByteArray()) + width + " w\n" + path(type, args, ranges) +
+            paint + (round ? " Q\n" : "\n"));
+    }
+}
+
+bool Exporter::end(QString *error)
+{
+    if (_format == Svg)
+        put("</g>\n</svg>\n");
+    else
+    {
+        qint64 length = offset() - _stream;
+        put("endstream\nendobj\n");
+        _objects.append(offset());
+        put("5 0 obj\n" + QByteArray::number(length) + "\nendobj\n");
+        qint64 xref = offset();
+        put("xref\n0 " + QByteArray::number(_objects.size() + 1) + "\n0000000000 65535 f \n");
+        foreach (qint64 o, _objects)
+            put(QByteArray::number(o).rightJustified(10, '0') + " 00000 n \n");
+        put("trailer\n<< /Size " + QByteArray::number(_objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" +
+            QByteArray::number(xref) + "\n%%EOF\n");
+    }
+    flush();
+    _file.close();
+    if (!_ok && error)
+        *error = QString("%1: %2").arg(_file.fileName()).arg(_file.errorString());
+    return _ok;
+}
+
+bool Exporter::save(const QString &file, QSize size, const QList<Primitive *> &primitives, QString *error)
+{
+    Exporter exporter(QFileInfo(file).suffix().toLower() == "pdf" ? Pdf : Svg);
+    if (!exporter.begin(file, size, error))
+        return false;
+    foreach (Primitive *p, primitives)
+        exporter.write(p);
+    return exporter.end(error);
+}
+
+QByteArray Exporter::path(Primitive::Type type, Points args, const Ranges &ranges) const
+{
+    bool svg = _format == Svg;
+    QByteArray d;
+    auto point = [&](QPointF p)
+    {
+        d += num(p.x()) + " " + num(p.y()) + " ";
+    };
+    auto moveTo = [&](QPointF p)
+    {
+        if (svg) { d += "M"; point(p); }
+        else { point(p); d += "m "; }
+    };
+    auto lineTo = [&](QPointF p)
+    {
+        if (svg) { d += "L"; point(p); }
+        else { point(p); d += "l "; }
+    };
+    auto cubicTo = [&](QPointF b1, QPointF b2, QPointF b3)
+    {
+        if (svg) d += "C";
+        point(b1);
+        point(b2);
+        point(b3);
+        if (!svg) d += "c ";
+    };
+    auto close = [&]()
+    {
+        d += svg ? "Z " : "h ";
+    };
+    switch (type)
+    {
+    case Primitive::Line:
+        moveTo(args[0]);
+        lineTo(args[args.size() > 1 ? 1 : 0]);
+        break;
+    case Primitive::Polygon:
+        moveTo(args[0]);
+        for (int i = 1; i < args.size(); ++i)
+            lineTo(args[i]);
+        close();
+        break;
+    case Primitive::Circle:
+    case Primitive::Ellipse:
+    {
+        // 四段贝塞尔曲线近似整个椭圆，仅在PDF中使用
+        QPointF c = args[0];
+        qreal rx = qMax(qAbs(args[1].x()), 1), ry = qMax(qAbs(args[1].y()), 1);
+        if (type == Primitive::Circle)
+            rx = ry = qMin(qAbs(args[1].x()), qAbs(args[1].y()));
+        if (!ranges.isEmpty())
+        {
+            // 椭圆弧按不超过四分之一的小段用贝塞尔曲线近似，每个参数角区间是一条子路径
+            auto at = [&](qreal t) { return c + QPointF(rx * qCos(t), ry * qSin(t)); };
+            auto tangent = [&](qreal t) { return QPointF(-rx * qSin(t), ry * qCos(t)); };
+            foreach (auto range, ranges)
+            {
+                int n = qCeil((range.second - range.first) / M_PI_2);
+                qreal step = (range.second - range.first) / qMax(n, 1), k = 4.0 / 3 * qTan(step / 4);
+                moveTo(at(range.first));
+                for (int i = 0; i < n; ++i)
+                {
+                    qreal t0 = range.first + i * step, t1 = t0 + step;
+                    cubicTo(at(t0) + k * tangent(t0), at(t1) - k * tangent(t1), at(t1));
+                }
+            }
+            break;
+        }
+        qreal kx = rx * kappa, ky = ry * kappa;
+        moveTo(c + QPointF(rx, 0));
+        cubicTo(c + QPointF(rx, ky), c + QPointF(kx, ry), c + QPointF(0, ry));
+        cubicTo(c + QPointF(-kx, ry), c + QPointF(-rx, ky), c + QPointF(-rx, 0));
+        cubicTo(c + QPointF(-rx, -ky), c + QPointF(-kx, -ry), c + QPointF(0, -ry));
+        cubicTo(c + QPointF(kx, -ry), c + QPointF(rx, -ky), c + QPointF(rx, 0));
+        close();
+        break;
+    }
+    case Primitive::Curve:
+    {
+        // 均匀三次B样条每段都等价于一条三次贝塞尔曲线，相邻段首尾相接，裁剪后每个参数区间是一条子路径
+        Raster::sections(args, ranges, [&](const QPointF b[4], bool first)
+        {
+            if (first)
+                moveTo(b[0]);
+            cubicTo(b[1], b[2], b[3]);
+        });
+        break;
+    }
+    }
+    d.chop(1);
+    return svg ? d : d + "\n";
+}
+
+void Exporter::put(const QByteArray &data)
+{
+    _buffer += data;
+    if (_buffer.size() >= 65536)
+        flush();
+}
+
+bool Exporter::flush()
+{
+    _ok = _ok && _file.write(_buffer) == _buffer.size();
+    _written += _buffer.size();
+    _buffer.clear();
+    return _ok;
+}
+
+qint64 Exporter::offset() const
+{
+    return _written + _buffer.size();
+}
@@ -0,0 +1,41 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "primitive.h"
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QSize>
+#include <QString>
+
+// 矢量导出：直接由图元类型和参数生成SVG或PDF，不经过光栅化。
+// 直线和多边形输出为路径，圆和椭圆输出为原生元素（PDF中为四段贝塞尔曲线），
+// B样条曲线逐段转换为三次贝塞尔曲线，裁剪后只输出可见部分。输出先写入小缓冲区，满了就写入文件，不在内存中拼出整个文档
+class Exporter
+{
+public:
+    enum Format { Svg, Pdf };
+    explicit Exporter(Format format);
+    ~Exporter();
+    bool begin(const QString &file, QSize size, QString *error = nullptr);	// 创建文件并写出文档头
+    void write(Primitive *p);												// 写出一个图元
+    bool end(QString *error = nullptr);										// 写出文档尾并关闭文件
+    static bool save(const QString &file, QSize size, const QList<Primitive *> &primitives,
+                     QString *error = nullptr);	// 按文件后缀选择格式导出图元列表
+private:
+    Q_DISABLE_COPY(Exporter)
+    QByteArray path(Primitive::Type type, Points args, const Ranges &ranges) const;	// 生成路径数据
+    void put(const QByteArray &data);	// 追加到缓冲区，缓冲区满了就写入文件
+    bool flush();						// 把缓冲区写入文件
+    qint64 offset() const;				// 已输出的字节数，用于PDF交叉引用表
+    Format _format;				// 输出格式
+    QFile _file;				// 输出文件
+    QByteArray _buffer;			// 待写入的数据
+    qint64 _written;			// 已写入文件的字节数
+    QSize _size;				// 画布大小
+    qint64 _stream;				// PDF内容流的起始位置
+    QVector<qint64> _objects;	// PDF各对象的起始位置
+    bool _ok;					// 写入是否一直成功
+};
+
+#endif // EXPORTER_H
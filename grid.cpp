@@ -0,0 +1,150 @@
+#include "grid.h"
+#include "primitive.h"
+
+static const int maxCells = 256;	// 超过该格子数的图元不再逐格登记
+
+Grid::Grid(int size)
+    : _size(size), _next(0)
+{
+
+}
+
+void Grid::insert(Primitive *p)
+{
+    if (!_entries.contains(p))
+        insert(p, _next++);
+}
+
+void Grid::insert(Primitive *p, quint64 order)
+{
+    if (_entries.contains(p))
+        return;
+    Entry e;
+    e.order = order;
+    e.cells = cellsOf(p->rect());
+    e.large = e.cells.width() * e.cells.height() > maxCells;
+    link(p, e);
+    _entries.insert(p, e);
+    p->setGrid(this);
+}
+
+void Grid::remove(Primitive *p)
+{
+    auto it = _entries.find(p);
+    if (it == _entries.end())
+        return;
+    unlink(p, it.value());
+    _entries.erase(it);
+    p->setGrid(nullptr);
+}
+
+quint64 Grid::order(Primitive *p) const
+{
+    return _entries.value(p).order;
+}
+
+void Grid::update(Primitive *p)
+{
+    auto it = _entries.find(p);
+    if (it == _entries.end())
+        return;
+    QRect cells = cellsOf(p->rect());
+    if (cells == it.value().cells)
+        return;
+    unlink(p, it.value());
+    it.value().cells = cells;
+    it.value().large = cells.width() * cells.height() > maxCells;
+    link(p, it.value());
+}
+
+void Grid::clear()
+{
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+        it.key()->setGrid(nullptr);
+    _cells.clear();
+    _entries.clear();
+    _large.clear();
+}
+
+QVector<Primitive *> Grid::query(QRect r) const
+{
+    QVector<QPair<quint64, Primitive *>> found;
+    auto collect = [&](Primitive *p)
+    {
+        if (p->rect().intersects(r))
+            found.append({_entries.value(p).order, p});
+    };
+    QRect cells = cellsOf(r);
+    if (!cells.isNull() && qint64(cells.width()) * cells.height() > _cells.size())
+    {
+        // 缩小视口时查询范围的格子数可能远多于非空格子，改为遍历非空格子
+        for (auto it = _cells.constBegin(); it != _cells.constEnd(); ++it)
+            if (cells.contains(int(it.key() >> 32), int(quint32(it.key()))))
+                foreach (Primitive *p, it.value())
+                    collect(p);
+    }
+    else if (!cells.isNull())
+        for (int y = cells.top(); y <= cells.bottom(); ++y)
+            for (int x = cells.left(); x <= cells.right(); ++x)
+            {
+                auto it = _cells.constFind(key(x, y));
+                if (it != _cells.constEnd())
+                    foreach (Primitive *p, it.value())
+                        collect(p);
+            }
+    foreach (Primitive *p, _large)
+        collect(p);
+    std::sort(found.begin(), found.end());
+    QVector<Primitive *> result;
+    for (int i = 0; i < found.size(); ++i)
+        if (!i || found[i].second != found[i - 1].second)
+            result.append(found[i].second);
+    return result;
+}
+
+QRect Grid::cellsOf(QRect r) const
+{
+    if (r.isNull())
+        return QRect();
+    auto floorDiv = [=](int a) { return a >= 0 ? a / _size : -((-a + _size - 1) / _size); };
+    return QRect(QPoint(floorDiv(r.left()), floorDiv(r.top())),
+                 QPoint(floorDiv(r.right()), floorDiv(r.bottom())));
+}
+
+void Grid::link(Primitive *p, const Entry &e)
+{
+    if (e.cells.isNull())
+        return;
+    if (e.large)
+    {
+        _large.append(p);
+        return;
+    }
+    for (int y = e.cells.top(); y <= e.cells.bottom(); ++y)
+        for (int x = e.cells.left(); x <= e.cells.right(); ++x)
+            _cells[key(x, y)].append(p);
+}
+
+void Grid::unlink(Primitive *p, const Entry &e)
+{
+    if (e.cells.isNull())
+        return;
+    if (e.large)
+    {
+        _large.removeOne(p);
+        return;
+    }
+    for (int y = e.cells.top(); y <= e.cells.bottom(); ++y)
+        for (int x = e.cells.left(); x <= e.cells.right(); ++x)
+        {
+            auto it = _cells.find(key(x, y));
+            it.value().removeOne(p);
+            if (it.value().isEmpty())
+                _cells.erase(it);
+        }
+}
+
+quint64 Grid::key(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
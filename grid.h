@@ -0,0 +1,40 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <QRect>
+#include <QHash>
+#include <QVector>
+
+class Primitive;
+
+// 均匀网格空间索引，按包围盒把图元登记到覆盖的格子中，拾取时只检查附近的候选图元
+class Grid
+{
+public:
+    explicit Grid(int size = 64);
+    void insert(Primitive *p);	// 登记图元，图元之后修改参数时会自动更新索引
+    void insert(Primitive *p, quint64 order);	// 按指定的插入序号登记图元，用于撤销删除时恢复原来的顺序
+    quint64 order(Primitive *p) const;			// 图元的插入序号
+    void remove(Primitive *p);	// 注销图元
+    void update(Primitive *p);	// 图元包围盒变化后更新所在格子
+    void clear();				// 清空索引
+    QVector<Primitive *> query(QRect r) const;	// 查询包围盒与矩形相交的图元，按插入顺序排列
+private:
+    struct Entry
+    {
+        quint64 order;	// 插入序号，保证查询结果与图元列表顺序一致
+        QRect cells;	// 图元占据的格子范围
+        bool large;		// 占据格子过多的图元单独存放
+    };
+    QRect cellsOf(QRect r) const;	// 计算矩形覆盖的格子范围
+    void link(Primitive *p, const Entry &e);
+    void unlink(Primitive *p, const Entry &e);
+    static quint64 key(int x, int y);
+    int _size;			// 格子边长
+    quint64 _next;		// 下一个插入序号
+    QHash<quint64, QVector<Primitive *>> _cells;	// 格子到图元的映射
+    QHash<Primitive *, Entry> _entries;				// 已登记的图元
+    QVector<Primitive *> _large;					// 覆盖大量格子的图元
+};
+
+#endif // GRID_H
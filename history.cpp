@@ -0,0 +1,201 @@
+#include "history.h"
+
+History::History(Store &store, Grid &grid, qint64 budget)
+    : _store(store), _grid(grid), _budget(budget), _memory(0), _current(0), _depth(0), _open(false)
+{
+
+}
+
+History::~History()
+{
+    clear();
+}
+
+void History::begin()
+{
+    ++_depth;
+}
+
+void History::end()
+{
+    if (_depth == 0 || --_depth > 0 || !_open)
+        return;
+    _open = false;
+    _current = _steps.size();
+    trim();
+}
+
+void History::insert(Primitive *p)
+{
+    record(Insert, p);
+}
+
+void History::remove(Primitive *p)
+{
+    record(Remove, p);
+}
+
+void History::modify(Primitive *p)
+{
+    record(Modify, p);
+}
+
+QRect History::undo()
+{
+    if (!canUndo())
+        return QRect();
+    Step &step = _steps[--_current];
+    QRect r;
+    for (int i = step.changes.size() - 1; i >= 0; --i)
+        r |= apply(step.changes[i], false);
+    _memory -= step.bytes;
+    step.bytes = 0;
+    foreach (const Change &c, step.changes)
+        step.bytes += bytes(c);
+    _memory += step.bytes;
+    return r;
+}
+
+QRect History::redo()
+{
+    if (!canRedo())
+        return QRect();
+    Step &step = _steps[_current++];
+    QRect r;
+    for (int i = 0; i < step.changes.size(); ++i)
+        r |= apply(step.changes[i], true);
+    _memory -= step.bytes;
+    step.bytes = 0;
+    foreach (const Change &c, step.changes)
+        step.bytes += bytes(c);
+    _memory += step.bytes;
+    return r;
+}
+
+bool History::canUndo() const
+{
+    return _current > 0 && !_open;
+}
+
+bool History::canRedo() const
+{
+    return _current < _steps.size() && !_open;
+}
+
+void History::clear()
+{
+    for (int i = _steps.size() - 1; i >= 0; --i)
+        drop(_steps[i], i >= _current);
+    _steps.clear();
+    _memory = 0;
+    _current = 0;
+    _open = false;
+}
+
+qint64 History::memory() const
+{
+    return _memory;
+}
+
+void History::setBudget(qint64 bytes)
+{
+    _budget = bytes;
+    trim();
+}
+
+void History::record(Kind kind, Primitive *p)
+{
+    if (!_store.contains(p))
+        return;
+    if (_depth == 0)
+    {
+        // 不在begin和end之间的修改单独成为一步
+        begin();
+        record(kind, p);
+        end();
+        return;
+    }
+    if (!_open)
+    {
+        // 新的修改使可以重做的步骤失效
+        while (_steps.size() > _current)
+        {
+            _memory -= _steps.last().bytes;
+            drop(_steps.last(), true);
+            _steps.removeLast();
+        }
+        _steps.append(Step());
+        _steps.last().bytes = 0;
+        _open = true;
+    }
+    Change c = {kind, p, 0, QVector<QPoint>(), Ranges()};
+    if (kind == Modify)
+    {
+        c.args = p->args();
+        c.ranges = p->ranges();
+    }
+    else if (kind == Remove)
+        apply(c, true);
+    Step &step = _steps.last();
+    step.changes.append(c);
+    qint64 b = bytes(c);
+    step.bytes += b;
+    _memory += b;
+}
+
+QRect History::apply(Change &c, bool forward)
+{
+    Primitive *p = c.primitive;
+    QRect r = p->rect();
+    if (c.kind == Modify)
+    {
+        // 与图元当前的参数交换，同一条记录既能撤销也能重做
+        QVector<QPoint> args = p->args();
+        Ranges ranges = p->ranges();
+        p->setRanges(c.ranges);
+        p->setArgs(c.args);
+        c.args = args;
+        c.ranges = ranges;
+        return r | p->rect();
+    }
+    if ((c.kind == Insert) == forward)
+    {
+        _store.attach(p);
+        _grid.insert(p, c.order);
+    }
+    else
+    {
+        c.order = _grid.order(p);
+        _grid.remove(p);
+        _store.detach(p);
+    }
+    return r;
+}
+
+void History::drop(Step &step, bool undone)
+{
+    // 已执行步骤中删除的图元和已撤销步骤中新建的图元只由记录持有
+    foreach (const Change &c, step.changes)
+        if (c.kind == (undone ? Insert : Remove) && !_store.contains(c.primitive))
+            _store.destroy(c.primitive);
+}
+
+void History::trim()
+{
+    while (_memory > _budget && _current > 1)
+    {
+        _memory -= _steps.first().bytes;
+        drop(_steps.first(), false);
+        _steps.removeFirst();
+        --_current;
+    }
+}
+
+qint64 History::bytes(const Change &c) const
+{
+    qint64 b = sizeof(Change) + c.args.capacity() * qint64(sizeof(QPoint)) +
+               c.ranges.capacity() * qint64(sizeof(Ranges::value_type));
+    if (!_store.contains(c.primitive))
+        b += c.primitive->memory();
+    return b;
+}
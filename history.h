@@ -0,0 +1,61 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "primitive.h"
+#include "store.h"
+#include "grid.h"
+#include <QRect>
+#include <QVector>
+
+// 撤销和重做：每一步只记录受影响的图元，修改记录保存另一份参数，撤销和重做时与图元当前参数交换，
+// 删除的图元只是从存储中取下，由记录持有，不复制参数。撤销只使受影响的图元重新光栅化。
+// 记录占用的内存超过预算时丢弃最早的步骤
+class History
+{
+public:
+    History(Store &store, Grid &grid, qint64 budget = 64 << 20);
+    ~History();
+    void begin();					// 开始记录一步，之后的修改合并为一步
+    void end();						// 结束记录，没有修改的步骤被丢弃
+    void insert(Primitive *p);		// 记录新建的图元
+    void remove(Primitive *p);		// 删除图元，从存储和空间索引中取下并由记录持有
+    void modify(Primitive *p);		// 记录图元修改前的参数，必须在修改之前调用
+    QRect undo();					// 撤销一步，返回需要重绘的区域
+    QRect redo();					// 重做一步，返回需要重绘的区域
+    bool canUndo() const;			// 是否有可以撤销的步骤
+    bool canRedo() const;			// 是否有可以重做的步骤
+    void clear();					// 清空记录，删除记录持有的图元
+    qint64 memory() const;			// 记录占用的字节数
+    void setBudget(qint64 bytes);	// 设置内存预算
+private:
+    Q_DISABLE_COPY(History)
+    enum Kind { Insert, Remove, Modify };
+    struct Change
+    {
+        Kind kind;				// 修改类型
+        Primitive *primitive;	// 受影响的图元
+        quint64 order;			// 取下时在空间索引中的插入序号
+        QVector<QPoint> args;	// 修改记录保存的另一份参数
+        Ranges ranges;			// 修改记录保存的另一份参数区间
+    };
+    struct Step
+    {
+        QVector<Change> changes;	// 按发生顺序排列的修改
+        qint64 bytes;				// 占用的字节数
+    };
+    void record(Kind kind, Primitive *p);
+    QRect apply(Change &c, bool forward);	// 执行或撤销一个修改
+    void drop(Step &step, bool undone);		// 丢弃步骤并删除其中只由记录持有的图元
+    void trim();							// 超过预算时丢弃最早的步骤
+    qint64 bytes(const Change &c) const;	// 一个修改占用的字节数
+    Store &_store;
+    Grid &_grid;
+    qint64 _budget;			// 内存预算
+    qint64 _memory;			// 所有步骤占用的字节数
+    QVector<Step> _steps;	// 所有步骤，前_current步可以撤销，其余可以重做
+    int _current;			// 已执行的步骤数
+    int _depth;				// begin的嵌套层数
+    bool _open;				// 最后一步是否仍在记录中
+};
+
+#endif // HISTORY_H
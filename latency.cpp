@@ -0,0 +1,69 @@
+#include "latency.h"
+#include <algorithm>
+
+Latency::Latency(int window)
+    : _window(qMax(window, 1))
+{
+    clear();
+}
+
+void Latency::input(qint64 ns)
+{
+    ++_events;
+    if (_pending < 0)
+        _pending = ns;
+}
+
+void Latency::present(qint64 ns)
+{
+    if (_pending < 0)
+        return;
+    qint64 d = ns - _pending;
+    _pending = -1;
+    if (_samples.size() < _window)
+        _samples.append(d);
+    else
+        _samples[_next] = d;
+    _next = (_next + 1) % _window;
+    ++_frames;
+    _total += d;
+    _max = qMax(_max, d);
+}
+
+void Latency::clear()
+{
+    _samples.clear();
+    _next = _frames = 0;
+    _events = _total = _max = 0;
+    _pending = -1;
+}
+
+int Latency::frames() const
+{
+    return _frames;
+}
+
+qint64 Latency::events() const
+{
+    return _events;
+}
+
+qint64 Latency::mean() const
+{
+    return _frames ? _total / _frames : 0;
+}
+
+qint64 Latency::max() const
+{
+    return _max;
+}
+
+qint64 Latency::percentile(qreal p) const
+{
+    if (_samples.isEmpty())
+        return 0;
+    QVector<qint64> s = _samples;
+    int k = qBound(0, int(p * (s.size() - 1) + 0.5), s.size() - 1);
+    std::nth_element(s.begin(), s.begin() + k, s.end());
+    return s[k];
+}
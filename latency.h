@@ -0,0 +1,32 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// 拖动延迟统计：每帧记录最早一个未呈现的输入事件到画面呈现的时间，
+// 以及这一帧合并掉的输入事件数。只保留最近若干帧的样本用于计算分位数，总数和最大值累计全部帧
+class Latency
+{
+public:
+    explicit Latency(int window = 1024);
+    void input(qint64 ns);		// 收到输入事件，ns为收到时刻，同一帧内只保留最早的时刻
+    void present(qint64 ns);	// 画面已呈现，结算本帧的延迟，没有待呈现的输入时忽略
+    void clear();				// 清空统计
+    int frames() const;			// 有输入的帧数
+    qint64 events() const;		// 输入事件总数
+    qint64 mean() const;		// 平均延迟，单位纳秒
+    qint64 max() const;			// 最大延迟
+    qint64 percentile(qreal p) const;	// 最近若干帧中的延迟分位数，p在0到1之间
+private:
+    QVector<qint64> _samples;	// 最近若干帧的延迟，循环使用
+    int _window;			// 保留的样本数
+    int _next;				// 下一个样本的位置
+    int _frames;			// 有输入的帧数
+    qint64 _events;			// 输入事件总数
+    qint64 _total;			// 延迟总和
+    qint64 _max;			// 最大延迟
+    qint64 _pending;		// 本帧最早的输入时刻，-1表示没有待呈现的输入
+};
+
+#endif // LATENCY_H
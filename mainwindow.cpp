@@ -5,112 +5,230 @@ MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     state(Line),
+    history(store, grid),
     primitive(nullptr),
-    pen(Qt::black, 3)
+    frame(QPen(Qt::black, 1), Primitive::Polygon, {QPoint(), QPoint(), QPoint(), QPoint()}),
+    panning(false),
+    pressed(false),
+    pen(Qt::black, 3),
+    filling(false),
+    fillRule(Qt::OddEvenFill),
+    moved(false),
+    overlay(false),
+    decodes(0)
 {
     ui->setupUi(this);
+    // 帧间隔跟随屏幕刷新率，拖动期间定时器一直运行，空闲一帧后停止
+    qreal rate = QGuiApplication::primaryScreen() ? QGuiApplication::primaryScreen()->refreshRate() : 60;
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    frameTimer.setInterval(qMax(1, qRound(1000 / qMax(rate, 1.0))));
+    connect(&frameTimer, &QTimer::timeout, this, &MainWindow::nextFrame);
+    clock.start();
+    connect(&loader, &QFutureWatcher<QImage>::finished, this, &MainWindow::backgroundLoaded);
+    connect(new QShortcut(QKeySequence("Ctrl+M"), this), &QShortcut::activated, this, &MainWindow::reportMemory);
+    connect(new QShortcut(QKeySequence("Ctrl+L"), this), &QShortcut::activated, this, &MainWindow::reportLatency);
+    connect(new QShortcut(QKeySequence("Ctrl+P"), this), &QShortcut::activated, this, &MainWindow::toggleProfiler);
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+P"), this), &QShortcut::activated, this, &MainWindow::saveTrace);
+    connect(new QShortcut(QKeySequence("Ctrl+0"), this), &QShortcut::activated, this, &MainWindow::resetView);
+    connect(new QShortcut(QKeySequence("Ctrl+R"), this), &QShortcut::activated, this, &MainWindow::toggleCap);
+    connect(new QShortcut(QKeySequence("Ctrl+F"), this), &QShortcut::activated, this, &MainWindow::toggleFill);
+    connect(new QShortcut(QKeySequence("Ctrl+Y"), this), &QShortcut::activated, this, &MainWindow::redo);
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+Z"), this), &QShortcut::activated, this, &MainWindow::redo);
 }
 
 MainWindow::~MainWindow()
 {
-    foreach (Primitive *p, primitives)
-        delete p;
     delete ui;
 }
 
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event)
-    image.fill(Qt::white);
-    painter.begin(&image);
-    if (!s.isEmpty())
+    // 控制点标记在画布上是固定大小的圆点，所占区域按画布坐标计算，不随缩放变化
+    QRect m;
+    if (state == Polygon || state == Curve)
+        foreach (QPoint p, points)
+            m |= view.toScreen(QRect(p, p)).adjusted(-5, -5, 5, 5);
+    if (m != marks)
     {
-        QImage temp(s);
-        painter.drawImage(QPoint((image.width() - temp.width()) / 2, (image.height() - temp.height()) / 2),temp);
+        dirty |= marks | m;
+        marks = m;
     }
-    foreach (Primitive *p, primitives)
+    QRect r = dirty & image.rect();
+    dirty = QRect();
+    if (r.isEmpty())
     {
-        painter.setPen(p->pen());
-        painter.drawPoints(p->points());
+        latency.present(clock.nsecsElapsed());
+        return;
     }
-    if (state == Polygon || state == Curve)
+    ProfileScope frameScope("frame");
+    Profiler::beginFrame();
     {
-        painter.setBrush(QBrush(Qt::black));
-        foreach (QPoint p, points)
-            painter.drawEllipse(p, 4, 4);
+        ProfileScope scope("background");
+        painter.begin(&image);
+        painter.setClipRect(r);
+        painter.fillRect(r, Qt::white);
+        if (!background.isNull())
+        {
+            // 背景图片固定在世界坐标中，随视口平移缩放
+            painter.setTransform(view.transform());
+            painter.drawImage(backgroundPos, background);
+        }
+        painter.end();
     }
-    if (state == Clip && primitive)
     {
-        painter.setPen(primitive->pen());
-        painter.drawPoints(primitive->points());
+        // 只重新绘制包围盒与视口中重绘区域相交的图元，视口外的图元在光栅化之前就被剔除，
+        // 查询结果保持图元列表的顺序，像素直接写入画布，拖动裁剪窗口时图元只绘制在窗口内
+        ProfileScope scope("composite");
+        QRect s = scissor.isNull() ? r : r & view.toScreen(scissor).adjusted(1, 1, -1, -1);
+        renderer.render(image, s, grid.query(view.toWorld(s)), view);
+        if (state == Clip && primitive)
+            primitive->draw(image.bits(), image.bytesPerLine(), image.format(), r, view.transform());
+        if (state == Polygon || state == Curve)
+        {
+            painter.begin(&image);
+            painter.setClipRect(r);
+            painter.setBrush(QBrush(Qt::black));
+            foreach (QPoint p, points)
+                painter.drawEllipse(view.transform().map(p), 4, 4);
+            painter.end();
+        }
     }
-    painter.end();
-    ui->label->setPixmap(QPixmap::fromImage(image));
+    {
+        ProfileScope scope("present");
+        QPixmap pixmap = QPixmap::fromImage(image);
+        if (overlay)
+        {
+            // 叠加层画在显示用的位图上，不进入画布，显示的是上一帧的统计
+            QPainter p(&pixmap);
+            p.fillRect(QRect(0, 0, 220, 20), Qt::black);
+            p.setPen(Qt::white);
+            p.drawText(QRect(4, 0, 216, 20), Qt::AlignVCenter,
+                       QString("frame %1 ms, %2 px").arg(Profiler::frameTime() / 1e6, 0, 'f', 2).arg(Profiler::framePixels()));
+        }
+        ui->label->setPixmap(pixmap);
+    }
+    Profiler::endFrame();
+    latency.present(clock.nsecsElapsed());
 }
 
 void MainWindow::mousePressEvent(QMouseEvent *event)
 {
-    QPoint pos = event->pos();
-    pos.rx() -= 11;
-    pos.ry() -= 51;
+    if (event->button() == Qt::MiddleButton)
+    {
+        // 中键拖动平移视口
+        panning = true;
+        pending = panLast = ui->label->mapFrom(this, event->pos());
+        return;
+    }
+    pressed = true;
+    QPoint pos = view.toWorld(ui->label->mapFrom(this, event->pos()));
     points.append(pos);
     switch (state)
     {
     case Line:
-        primitive = new Primitive(pen, Primitive::Line,
+        primitive = store.create(pen, Primitive::Line,
         {pos, pos});
-        primitives.append(primitive);
+        grid.insert(primitive);
         break;
     case Triangle:
-        primitive = new Primitive(pen, Primitive::Polygon,
+        primitive = store.create(pen, Primitive::Polygon,
         {pos, pos, pos});
-        primitives.append(primitive);
+        applyBrush(primitive);
+        grid.insert(primitive);
         break;
     case Rectangle:
-        primitive = new Primitive(pen, Primitive::Polygon,
+        primitive = store.create(pen, Primitive::Polygon,
         {pos, pos, pos, pos});
-        primitives.append(primitive);
+        applyBrush(primitive);
+        grid.insert(primitive);
         break;
     case Circle:
-        primitive = new Primitive(pen, Primitive::Circle,
+        primitive = store.create(pen, Primitive::Circle,
         {pos, QPoint(0, 0)});
-        primitives.append(primitive);
+        applyBrush(primitive);
+        grid.insert(primitive);
         break;
     case Ellipse:
-        primitive = new Primitive(pen, Primitive::Ellipse,
+        primitive = store.create(pen, Primitive::Ellipse,
         {pos, QPoint(0, 0)});
-        primitives.append(primitive);
+        applyBrush(primitive);
+        grid.insert(primitive);
         break;
     case Polygon:
     case Curve:
         break;
     case Clip:
-        primitive = new Primitive(QPen(Qt::black, 1), Primitive::Polygon,
-        {pos, pos, pos, pos});
+        frame.setArgs({pos, pos, pos, pos});
+        primitive = &frame;
+        scissor = QRect(pos, pos);
+        invalidate();
         break;
     case Translate:
     case Rotate:
     case ZoomIn:
     case ZoomOut:
     case Trash:
+    {
+        // 拾取范围是画布上的5个像素，换算为世界坐标，缩小时变大，放大时变小，
+        // 但不小于一个世界单位，否则放大后点击的整数坐标很难落在图元上
         primitive = nullptr;
-        foreach (Primitive *p, primitives)
-            if (p->contain(points[0]))
+        qreal tolerance = qMax(5 / view.scale(), 1.0);
+        int margin = qCeil(tolerance);
+        foreach (Primitive *p, grid.query(QRect(points[0] - QPoint(margin, margin), points[0] + QPoint(margin, margin))))
+            if (p->contain(points[0], tolerance))
             {
                 primitive = p;
                 break;
             }
         break;
     }
+    }
+    if (primitive)
+        invalidate(primitive->rect());
     update();
 }
 
 void MainWindow::mouseMoveEvent(QMouseEvent *event)
 {
-    QPoint pos = event->pos();
-    pos.rx() -= 11;
-    pos.ry() -= 51;
+    // 移动事件只记录位置，几何更新由帧定时器驱动，每帧最多执行一次，高频鼠标和数位板的多余事件被合并
+    pending = ui->label->mapFrom(this, event->pos());
+    moved = true;
+    latency.input(clock.nsecsElapsed());
+    if (!frameTimer.isActive())
+    {
+        // 空闲后的第一个事件立即处理，之后的事件等到下一帧
+        drag();
+        frameTimer.start();
+    }
+}
+
+void MainWindow::nextFrame()
+{
+    if (moved)
+        drag();
+    else
+        frameTimer.stop();
+}
+
+void MainWindow::drag()
+{
+    ProfileScope scope("drag");
+    moved = false;
+    if (panning)
+    {
+        view.pan(pending - panLast);
+        panLast = pending;
+        invalidate();
+        update();
+        return;
+    }
+    // 按下时记录的起点被清空后（例如拖动中切换了工具），拖动不再有效
+    if (points.isEmpty())
+        return;
+    QPoint pos = view.toWorld(pending);
     QVector<QPoint> args;
+    QRect before = primitive ? primitive->rect() : QRect();
     switch (state)
     {
     case Line:
@@ -150,25 +268,26 @@ void MainWindow::mouseMoveEvent(QMouseEvent *event)
     case ZoomIn:
     case ZoomOut:
     case Trash:
-        break;
+        return;
     case Translate:
         if (!primitive)
             break;
-        args = primitive->translate(pos - points[0]);
-        primitive->setPoints(args);
+        // 拖动时只记录平移量，绘制时偏移已缓存的像素
+        primitive->setTransform(QTransform::fromTranslate(pos.x() - points[0].x(), pos.y() - points[0].y()));
         break;
     case Clip:
+    {
         primitive->setArgs({points[0],
                             {points[0].x(), pos.y()},
                             pos,
                             {pos.x(), points[0].y()}});
-        foreach (Primitive *p, primitives)
-        {
-            args = primitive->args();
-            args = p->clip(args[0], args[2]);
-            p->setPoints(args);
-        }
+        // 拖动时不修改图元，只重绘裁剪窗口变化的区域，松开鼠标后才真正裁剪
+        QRect old = scissor;
+        scissor = QRect(QPoint(qMin(points[0].x(), pos.x()), qMin(points[0].y(), pos.y())),
+                        QPoint(qMax(points[0].x(), pos.x()), qMax(points[0].y(), pos.y())));
+        invalidate(old | scissor);
         break;
+    }
     case Rotate:
         if (!primitive)
             break;
@@ -176,34 +295,51 @@ void MainWindow::mouseMoveEvent(QMouseEvent *event)
         qreal product = a.x() * b.y() - a.y() * b.x();
         qreal aNorm = qSqrt(qreal(a.x() * a.x() + a.y() * a.y()));
         qreal bNorm = qSqrt(qreal(b.x() * b.x() + b.y() * b.y()));
-        args = primitive->rotate(qAsin(product / aNorm / bNorm));
-        primitive->setPoints(args);
+        primitive->setTransform(QTransform().translate(primitive->center().x(), primitive->center().y())
+                                .rotateRadians(qAsin(product / aNorm / bNorm))
+                                .translate(-primitive->center().x(), -primitive->center().y()));
         break;
     }
+    if (primitive)
+        invalidate(before | primitive->rect());
     update();
 }
 
 void MainWindow::mouseReleaseEvent(QMouseEvent *event)
 {
-    QPoint pos = event->pos();
-    pos.rx() -= 11;
-    pos.ry() -= 51;
+    if (panning)
+    {
+        if (moved)
+            drag();
+        panning = false;
+        return;
+    }
+    QPoint pos = view.toWorld(ui->label->mapFrom(this, event->pos()));
+    // 松开时的位置取代尚未处理的移动事件
+    moved = false;
+    pressed = false;
+    if (points.isEmpty())
+        return;
     QVector<QPoint> args;
+    QRect before = primitive ? primitive->rect() : QRect();
     switch (state)
     {
     case Line:
         primitive->setArgs({points[0], pos});
+        history.insert(primitive);
         break;
     case Triangle:
         primitive->setArgs({pos,
                             {(points[0].x() + pos.x()) / 2, points[0].y()},
                             {points[0].x(), pos.y()}});
+        history.insert(primitive);
         break;
     case Rectangle:
         primitive->setArgs({points[0],
                             {points[0].x(), pos.y()},
                             pos,
                             {pos.x(), points[0].y()}});
+        history.insert(primitive);
         break;
     case Circle:
         if (qAbs(pos.x() - points[0].x()) < qAbs(pos.y() - points[0].y()))
@@ -218,53 +354,80 @@ void MainWindow::mouseReleaseEvent(QMouseEvent *event)
                 pos.rx() = points[0].x() - qAbs(pos.ry() - points[0].y());
         primitive->setArgs({(pos + points[0]) / 2,
                             (pos - points[0]) / 2});
+        history.insert(primitive);
         break;
     case Ellipse:
         primitive->setArgs({(pos + points[0]) / 2,
                             (pos - points[0]) / 2});
+        history.insert(primitive);
         break;
     case Polygon:
-        primitive->setArgs(points);
-        break;
     case Curve:
+        // 第一次点击时记录新建的图元，之后每次点击记录增加的顶点
+        if (points.size() > 1)
+            history.modify(primitive);
         primitive->setArgs(points);
+        if (points.size() == 1)
+            history.insert(primitive);
         break;
     case Translate:
         if (!primitive)
             break;
-        args = primitive->translate(pos - points[0]);
-        primitive->setArgs(args);
+        primitive->setTransform(QTransform::fromTranslate(pos.x() - points[0].x(), pos.y() - points[0].y()));
+        history.modify(primitive);
+        primitive->commit();
         break;
     case Clip:
+    {
         primitive->setArgs({points[0],
                             {points[0].x(), pos.y()},
                             pos,
                             {pos.x(), points[0].y()}});
 
-        foreach (Primitive *p, primitives)
+        // 完全在窗口外的图元被删除，其余图元写入裁剪结果
+        scissor = QRect();
+        ProfileScope scope("clip");
+        history.begin();
+        foreach (const Clipper::Result &c, Clipper(points[0], pos).clip(store.primitives()))
         {
-            args = primitive->args();
-            args = p->clip(args[0], args[2]);
-            p->setArgs(args);
+            Primitive *p = c.primitive;
+            QRect r = p->rect();
+            if (c.where == Clipper::Inside)
+                continue;
+            if (c.where == Clipper::Outside)
+            {
+                history.remove(p);
+                invalidate(r);
+                continue;
+            }
+            history.modify(p);
+            p->setRanges(c.ranges);
+            p->setArgs(c.args);
+            invalidate(r | p->rect());
         }
-        delete primitive;
+        history.end();
+        invalidate(primitive->rect());
         primitive = nullptr;
         break;
+    }
     case ZoomIn:
         if (!primitive)
             break;
         args = primitive->scale(1.1);
+        history.modify(primitive);
         primitive->setArgs(args);
         break;
     case ZoomOut:
         if (!primitive)
             break;
         args = primitive->scale(0.9);
+        history.modify(primitive);
         primitive->setArgs(args);
         break;
     case Trash:
-        primitives.removeAll(primitive);
-        delete primitive;
+        history.remove(primitive);
+        primitive = nullptr;
+        invalidate(before);
         break;
     case Rotate:
         if (!primitive)
@@ -273,10 +436,15 @@ void MainWindow::mouseReleaseEvent(QMouseEvent *event)
         qreal product = a.x() * b.y() - a.y() * b.x();
         qreal aNorm = qSqrt(qreal(a.x() * a.x() + a.y() * a.y()));
         qreal bNorm = qSqrt(qreal(b.x() * b.x() + b.y() * b.y()));
-        args = primitive->rotate(qAsin(product / aNorm / bNorm));
-        primitive->setArgs(args);
+        primitive->setTransform(QTransform().translate(primitive->center().x(), primitive->center().y())
+                                .rotateRadians(qAsin(product / aNorm / bNorm))
+                                .translate(-primitive->center().x(), -primitive->center().y()));
+        history.modify(primitive);
+        primitive->commit();
         break;
     }
+    if (primitive)
+        invalidate(before | primitive->rect());
     update();
     if (state != Curve && state != Polygon)
         points.clear();
@@ -287,16 +455,193 @@ void MainWindow::resizeEvent(QResizeEvent *event)
     Q_UNUSED(event)
     ui->label->resize(ui->centralWidget->size() - QSize(22, 22));
     image = QImage(ui->label->size(), QImage::Format_RGB32);
+    backgroundPos = QPoint((image.width() - background.width()) / 2, (image.height() - background.height()) / 2);
+    invalidate();
+}
+
+void MainWindow::invalidate()
+{
+    dirty = image.rect();
+}
+
+void MainWindow::invalidate(QRect r)
+{
+    dirty |= view.toScreen(r);
+}
+
+void MainWindow::restart()
+{
+    points.clear();
+    if (state != Polygon && state != Curve)
+    {
+        primitive = nullptr;
+        return;
+    }
+    // 还没有点击过的空图元可以继续使用
+    if (!store.contains(primitive) || !primitive->argPoints().isEmpty())
+    {
+        primitive = store.create(pen, state == Polygon ? Primitive::Polygon : Primitive::Curve, {});
+        applyBrush(primitive);
+        grid.insert(primitive);
+    }
+}
+
+void MainWindow::applyBrush(Primitive *p)
+{
+    if (filling && p->type() != Primitive::Line && p->type() != Primitive::Curve)
+        p->setBrush(QBrush(pen.color()), fillRule);
 }
 
 void MainWindow::on_action_open_triggered()
 {
-    s = (QFileDialog::getOpenFileName(this, QString(), QString(), "Image Files(*.bmp *.jpg *.png)"));
+    QString file = QFileDialog::getOpenFileName(this, QString(), QString(),
+                                                "Image Files(*.bmp *.jpg *.png);;Scene Files(*.cgs *.txt)");
+    if (file.isEmpty())
+    {
+        background = QImage();
+        invalidate();
+        update();
+        return;
+    }
+    QString suffix = QFileInfo(file).suffix().toLower();
+    if (suffix == "cgs" || suffix == "txt")
+    {
+        // 场景文件替换当前所有图元，像素在第一次绘制时才生成
+        Scene scene;
+        QString error;
+        if (!scene.load(file, &error))
+        {
+            qDebug() << error;
+            return;
+        }
+        history.clear();
+        grid.clear();
+        scene.take(store);
+        foreach (Primitive *p, store.primitives())
+            grid.insert(p);
+        // 与撤销一样重新开始当前的交互，多边形和曲线模式下换一个新的空图元
+        primitive = nullptr;
+        restart();
+        invalidate();
+        update();
+        return;
+    }
+    // 只解码一次并预先转换为画布格式，绘制时直接拷贝像素
+    loader.setFuture(QtConcurrent::run([this, file]()
+    {
+        ++decodes;
+        return QImage(file).convertToFormat(QImage::Format_RGB32);
+    }));
+}
+
+void MainWindow::backgroundLoaded()
+{
+    background = loader.result();
+    backgroundPos = QPoint((image.width() - background.width()) / 2, (image.height() - background.height()) / 2);
+    invalidate();
+    update();
+}
+
+void MainWindow::reportMemory()
+{
+    const char *names[] = {"Line", "Polygon", "Circle", "Ellipse", "Curve"};
+    int count[5] = {}, pixels[5] = {};
+    qint64 bytes[5] = {};
+    const QList<Primitive *> &primitives = store.primitives();
+    for (int i = 0; i < store.size(); ++i)
+    {
+        int type = store.type(i);
+        ++count[type];
+        pixels[type] += primitives[i]->spans().pixels();
+        bytes[type] += primitives[i]->memory() + store.argCount(i) * int(sizeof(QPoint));
+    }
+    for (int i = 0; i < 5; ++i)
+        qDebug().nospace() << names[i] << ": " << count[i] << " primitives, " << pixels[i] << " pixels, "
+                           << bytes[i] << " bytes (" << (pixels[i] ? qreal(bytes[i]) / pixels[i] : 0.0) << " bytes/pixel)";
+    qDebug().nospace() << "Background: " << decodes.load() << " decodes";
+}
+
+void MainWindow::reportLatency()
+{
+    // 延迟从收到输入事件算起，到包含该输入的画面交给窗口为止
+    qDebug().nospace() << latency.frames() << " frames, " << latency.events() << " input events ("
+                       << (latency.frames() ? qreal(latency.events()) / latency.frames() : 0.0) << " per frame), latency mean "
+                       << latency.mean() / 1e6 << " ms, p50 " << latency.percentile(0.5) / 1e6 << " ms, p99 "
+                       << latency.percentile(0.99) / 1e6 << " ms, max " << latency.max() / 1e6 << " ms";
+}
+
+void MainWindow::wheelEvent(QWheelEvent *event)
+{
+    // 按住Ctrl滚动以光标为中心缩放，否则平移，按住Shift时横向平移
+    QPoint d = event->angleDelta();
+    if (event->modifiers() & Qt::ControlModifier)
+        view.zoom(qPow(1.25, d.y() / 120.0), ui->label->mapFrom(this, event->pos()));
+    else
+        view.pan(event->modifiers() & Qt::ShiftModifier ? QPoint(d.y(), d.x()) / 2 : d / 2);
+    invalidate();
+    update();
+}
+
+void MainWindow::resetView()
+{
+    view.reset();
+    invalidate();
+    update();
+}
+
+void MainWindow::toggleProfiler()
+{
+    overlay = !overlay;
+    Profiler::setEnabled(overlay);
+    dirty |= QRect(0, 0, 220, 20);
+    update();
+}
+
+void MainWindow::saveTrace()
+{
+    QString file = QFileDialog::getSaveFileName(this, QString(), QString(), "Trace Files(*.json)"), error;
+    if (!file.isEmpty() && !Profiler::save(file, &error))
+        qDebug() << error;
 }
 
 void MainWindow::on_action_save_triggered()
 {
-    image.save(QFileDialog::getSaveFileName(this, QString(), QString(), "Image Files(*.bmp *.jpg *.png)"));
+    // PNG和JPG保存当前视口看到的画布，BMP按世界坐标1:1保存整个场景，两者在对话框中分开列出
+    QString file = QFileDialog::getSaveFileName(this, QString(), QString(),
+                                                "View Images(*.png *.jpg);;Whole Scene Bitmap(*.bmp);;"
+                                                "Scene Files(*.cgs);;Vector Files(*.svg *.pdf)");
+    QString suffix = QFileInfo(file).suffix().toLower(), error;
+    if (suffix == "cgs")
+    {
+        if (!Scene::save(file, image.size(), store, &error))
+            qDebug() << error;
+    }
+    else if (suffix == "svg" || suffix == "pdf")
+    {
+        // 矢量导出直接使用图元参数，与画布像素数无关
+        if (!Exporter::save(file, image.size(), store.primitives(), &error))
+            qDebug() << error;
+    }
+    else if (suffix == "bmp")
+    {
+        // 按世界坐标1:1导出整个场景，与视口的平移和缩放无关，包括负坐标处的图元，分块绘制后逐行写入文件。
+        // 范围只由图元和背景的世界坐标决定，场景为空时导出视口看到的世界区域
+        QRect extent;
+        foreach (Primitive *p, store.primitives())
+            extent |= p->rect();
+        if (!background.isNull())
+            extent |= QRect(backgroundPos, background.size());
+        if (extent.isEmpty())
+            extent = view.toWorld(image.rect());
+        Canvas canvas(extent);
+        if (!background.isNull())
+            canvas.drawImage(backgroundPos, background);
+        canvas.draw(store.primitives());
+        if (!canvas.save(file, &error))
+            qDebug() << error;
+    }
+    else
+        image.save(file);
 }
 
 void MainWindow::on_action_line_triggered()
@@ -333,16 +678,17 @@ void MainWindow::on_action_polygon_triggered()
 {
     state = Polygon;
     points.clear();
-    primitive = new Primitive(pen, Primitive::Polygon, points);
-    primitives.append(primitive);
+    primitive = store.create(pen, Primitive::Polygon, points);
+    applyBrush(primitive);
+    grid.insert(primitive);
 }
 
 void MainWindow::on_action_curve_triggered()
 {
     state = Curve;
     points.clear();
-    primitive = new Primitive(pen, Primitive::Curve, points);
-    primitives.append(primitive);
+    primitive = store.create(pen, Primitive::Curve, points);
+    grid.insert(primitive);
 }
 void MainWindow::on_action_translate_triggered()
 {
@@ -400,3 +746,40 @@ void MainWindow::on_action_help_triggered()
 {
     QDesktopServices::openUrl(QUrl("https://github.com/GeekEmperor/Paint/blob/master/README.md"));
 }
+
+void MainWindow::on_action_undo_triggered()
+{
+    // 拖动中的图元还没有写入历史，此时撤销会让松开鼠标时找不到图元
+    if (pressed)
+        return;
+    invalidate(history.undo());
+    restart();
+    update();
+}
+
+void MainWindow::redo()
+{
+    if (pressed)
+        return;
+    invalidate(history.redo());
+    restart();
+    update();
+}
+
+void MainWindow::toggleCap()
+{
+    pen.setCapStyle(pen.capStyle() == Qt::RoundCap ? Qt::SquareCap : Qt::RoundCap);
+}
+
+void MainWindow::toggleFill()
+{
+    if (!filling)
+    {
+        filling = true;
+        fillRule = Qt::OddEvenFill;
+    }
+    else if (fillRule == Qt::OddEvenFill)
+        fillRule = Qt::WindingFill;
+    else
+        filling = false;
+}
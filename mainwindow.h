@@ -2,16 +2,36 @@
 #define MAINWINDOW_H
 
 #include "primitive.h"
+#include "grid.h"
+#include "store.h"
+#include "history.h"
+#include "renderer.h"
+#include "viewport.h"
+#include "scene.h"
+#include "canvas.h"
+#include "exporter.h"
+#include "clipper.h"
+#include "latency.h"
+#include "profiler.h"
 #include <QMainWindow>
 #include <QPaintEvent>
 #include <QMouseEvent>
+#include <QWheelEvent>
 #include <QDesktopServices>
 #include <QColorDialog>
+#include <QShortcut>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QScreen>
+#include <QtConcurrent>
 #include <QPainter>
 #include <QBrush>
 #include <QString>
 #include <QUrl>
+#include <atomic>
 
 namespace Ui {
 class MainWindow;
@@ -29,6 +49,7 @@ public:
     void mouseMoveEvent(QMouseEvent *event);	// 鼠标移动事件
     void mouseReleaseEvent(QMouseEvent *event);	// 鼠标松开事件
     void resizeEvent(QResizeEvent *event);		// 窗口调整事件
+    void wheelEvent(QWheelEvent *event);		// 滚轮事件，平移或缩放视口
 
 private slots:
     // 程序按钮对应的槽函数，切换程序状态
@@ -51,18 +72,56 @@ private slots:
     void on_action_addpoint_triggered();
     void on_action_deletepoint_triggered();
     void on_action_help_triggered();
+    void on_action_undo_triggered();
+    void redo();				// 重做上一次撤销的操作
+    void toggleCap();			// 切换画笔的方头和圆头
+    void toggleFill();			// 依次切换不填充、奇偶规则填充和非零环绕规则填充
+    void backgroundLoaded();	// 背景图片解码完成
+    void reportMemory();		// 按图元类型输出内存占用，以及背景图片的解码次数
+    void reportLatency();		// 输出拖动的帧数、合并的输入事件数和延迟分布
+    void nextFrame();			// 帧定时器触发，处理合并后的移动事件
+    void toggleProfiler();		// 开始或停止记录各阶段耗时，并显示帧耗时叠加层
+    void saveTrace();			// 把记录的阶段导出为Chrome trace-event JSON
+    void resetView();			// 视口回到原点，不缩放
 
 private:
+    void invalidate();			// 整个画布需要重绘
+    void invalidate(QRect r);	// 画布的某个区域需要重绘
+    void restart();				// 撤销或重做后放弃正在绘制的多边形和曲线，重新开始
+    void applyBrush(Primitive *p);	// 新建的封闭图元按当前设置填充，颜色与画笔相同
+    void drag();				// 按最近一次移动事件的位置更新正在操作的图元
     Ui::MainWindow *ui;
     enum State {Line, Triangle, Rectangle, Circle, Ellipse, Polygon, Curve,
                 Translate, Rotate, Clip, ZoomIn, ZoomOut, Trash} state;	// 程序状态
     QVector<QPoint> points;			// 记录鼠标点击位置
-    QList<Primitive *> primitives;	// 已经绘制的图元列表
+    Store store;					// 已经绘制的图元，分配在对象池中
+    Grid grid;						// 图元的空间索引，用于快速拾取
+    History history;				// 撤销和重做记录
+    Renderer renderer;				// 分块并行绘制图元
     Primitive *primitive;			// 当前操作的图元
+    Primitive frame;				// 裁剪窗口的边框，每次裁剪重复使用
+    Viewport view;					// 画布在世界坐标中的视口
+    bool panning;					// 是否正在用中键平移视口
+    bool pressed;					// 是否按着鼠标绘制或编辑图元，松开前不响应撤销和重做
+    QPoint panLast;					// 平移时上一次处理的画布位置
     QImage image;					// 画布
+    QRect dirty;					// 画布上需要重绘的区域，画布坐标
+    QRect marks;					// 上次绘制的控制点标记所占区域，画布坐标
+    QRect scissor;					// 拖动裁剪窗口时图元只绘制在该区域内，世界坐标
     QPen pen;						// 点的颜色和大小
+    bool filling;					// 新建的封闭图元是否填充
+    Qt::FillRule fillRule;			// 新建多边形的填充规则
     QPainter painter;				// 画笔，用于绘制单个点
-    QString s;
+    QImage background;				// 背景图片，已转换为画布格式
+    QPoint backgroundPos;			// 背景图片左上角的世界坐标
+    QTimer frameTimer;				// 拖动时每帧触发一次
+    QElapsedTimer clock;			// 输入和呈现时刻的时钟
+    QPoint pending;					// 最近一次尚未处理的移动位置，画布坐标
+    bool moved;						// 是否有尚未处理的移动事件
+    Latency latency;				// 输入到呈现的延迟统计
+    bool overlay;					// 是否显示帧耗时和像素数叠加层
+    QFutureWatcher<QImage> loader;	// 在后台线程解码背景图片
+    std::atomic<int> decodes;		// 背景图片解码次数，在解码线程中累加，绘制时不应增加
 };
 
 #endif // MAINWINDOW_H
@@ -1,12 +1,19 @@
 #include "primitive.h"
+#include "grid.h"
+#include "clipper.h"
+#include "store.h"
+#include "profiler.h"
+#include "canvas.h"
 
 Primitive::Primitive()
+    : _shaped(false), _cached(false), _rule(Qt::OddEvenFill), _fillCached(false), _grid(nullptr), _store(nullptr), _index(-1), _order(0)
 {
 
 }
 
 Primitive::Primitive(QPen pen, Primitive::Type type, QVector<QPoint> args)
-    : _pen(pen), _type(type)
+    : _pen(pen), _type(type), _shaped(false), _cached(false), _rule(Qt::OddEvenFill), _fillCached(false),
+      _grid(nullptr), _store(nullptr), _index(-1), _order(0)
 {
     setArgs(args);
 }
@@ -16,14 +23,134 @@ QPen Primitive::pen()
     return _pen;
 }
 
-bool Primitive::contain(QPoint pos)
+// 点到线段距离的平方
+static qreal distance2(QPointF p, QPointF a, QPointF b)
 {
-    foreach (QPoint p, _points)
+    QPointF ab = b - a, ap = p - a;
+    qreal len2 = QPointF::dotProduct(ab, ab);
+    qreal t = len2 > 0 ? qBound(0.0, QPointF::dotProduct(ap, ab) / len2, 1.0) : 0.0;
+    QPointF d = ap - ab * t;
+    return QPointF::dotProduct(d, d);
+}
+
+// 点到贝塞尔控制点凸包的距离是否小于阈值，凸包由四个三角形覆盖，凸包外的最近点落在某条两点连线上
+static bool nearHull(QPointF p, const QPointF b[4], qreal d2)
+{
+    auto cross = [](QPointF o, QPointF a, QPointF c)
     {
-        QPoint diff = p - pos;
-        if (diff.x() * diff.x() + diff.y() * diff.y() < 25)
+        return (a.x() - o.x()) * (c.y() - o.y()) - (a.y() - o.y()) * (c.x() - o.x());
+    };
+    for (int i = 0; i < 4; ++i)
+    {
+        QPointF a = b[(i + 1) % 4], c = b[(i + 2) % 4], e = b[(i + 3) % 4];
+        qreal s1 = cross(a, c, p), s2 = cross(c, e, p), s3 = cross(e, a, p);
+        if ((s1 >= 0 && s2 >= 0 && s3 >= 0) || (s1 <= 0 && s2 <= 0 && s3 <= 0))
             return true;
     }
+    for (int i = 0; i < 4; ++i)
+        for (int j = i + 1; j < 4; ++j)
+            if (distance2(p, b[i], b[j]) < d2)
+                return true;
+    return false;
+}
+
+// 在贝塞尔曲线段上局部细分，直到控制多边形足够平直后用弦近似
+static bool nearBezier(QPointF p, const QPointF b[4], qreal d2, int depth)
+{
+    if (!nearHull(p, b, d2))
+        return false;
+    if (depth == 0 || (distance2(b[1], b[0], b[3]) < 0.25 && distance2(b[2], b[0], b[3]) < 0.25))
+        return distance2(p, b[0], b[3]) < d2;
+    QPointF l[4], r[4];
+    Raster::split(b, l, r);
+    return nearBezier(p, l, d2, depth - 1) || nearBezier(p, r, d2, depth - 1);
+}
+
+bool Primitive::contain(QPoint pos, qreal tolerance)
+{
+    const qreal d2 = tolerance * tolerance;
+    int margin = qCeil(tolerance);
+    Points args = argPoints();
+    int n = args.size();
+    if (!n || !_rect.adjusted(-margin, -margin, margin, margin).contains(pos))
+        return false;
+    if (filled() && fillSpans().near(pos, 1))
+        return true;
+    switch (_type)
+    {
+    case Line:
+    case Polygon:
+        if (n == 1)
+            return distance2(pos, args[0], args[0]) < d2;
+        for (int i = 0; i < n; ++i)
+        {
+            if (_type == Line && i == n - 1)
+                break;
+            if (distance2(pos, args[i], args[(i + 1) % n]) < d2)
+                return true;
+        }
+        return false;
+    case Circle:
+    case Ellipse:
+    {
+        QPointF d = pos - args[0];
+        qreal len = qSqrt(QPointF::dotProduct(d, d));
+        qreal rx = qAbs(args[1].x()), ry = qAbs(args[1].y());
+        if (_type == Circle)
+            rx = ry = qMin(rx, ry);
+        else
+        {
+            rx = qMax(rx, 1.0);
+            ry = qMax(ry, 1.0);
+        }
+        if (len == 0)
+            return qMin(rx, ry) < tolerance && _ranges.isEmpty();
+        bool near;
+        qreal px = qAbs(d.x()), py = qAbs(d.y()), tx = px / len, ty = py / len;
+        if (rx == ry)
+            near = qAbs(len - rx) < tolerance;
+        else
+        {
+            // 沿径向迭代逼近椭圆上的最近点，几次迭代即可收敛
+            tx = ty = M_SQRT1_2;
+            for (int i = 0; i < 3; ++i)
+            {
+                qreal ex = (rx * rx - ry * ry) * tx * tx * tx / rx;
+                qreal ey = (ry * ry - rx * rx) * ty * ty * ty / ry;
+                qreal qx = px - ex, qy = py - ey;
+                qreal r = qSqrt((rx * tx - ex) * (rx * tx - ex) + (ry * ty - ey) * (ry * ty - ey));
+                qreal q = qSqrt(qx * qx + qy * qy);
+                tx = qBound(0.0, (qx * r / q + ex) / rx, 1.0);
+                ty = qBound(0.0, (qy * r / q + ey) / ry, 1.0);
+                qreal t = qSqrt(tx * tx + ty * ty);
+                tx /= t;
+                ty /= t;
+            }
+            near = distance2(QPointF(px, py), QPointF(rx * tx, ry * ty), QPointF(rx * tx, ry * ty)) < d2;
+        }
+        if (!near || _ranges.isEmpty())
+            return near;
+        // 圆弧和椭圆弧还要求最近点的参数角落在可见区间附近
+        qreal u = qAtan2(ty, tx);
+        qreal t = d.y() < 0 ? (d.x() < 0 ? M_PI + u : 2 * M_PI - u) : (d.x() < 0 ? M_PI - u : u);
+        qreal slack = tolerance / qMin(rx, ry);
+        foreach (auto range, _ranges)
+            if (qAbs(std::remainder(t - (range.first + range.second) / 2, 2 * M_PI)) <= (range.second - range.first) / 2 + slack)
+                return true;
+        return false;
+    }
+    case Curve:
+    {
+        if (n < 4)
+            return spans().near(pos, margin);
+        bool near = false;
+        Raster::sections(args, _ranges, [&](const QPointF b[4], bool)
+        {
+            near = near || nearBezier(pos, b, d2, 16);
+        });
+        return near;
+    }
+    }
     return false;
 }
 
@@ -32,6 +159,11 @@ QPoint Primitive::center() const
     return _center;
 }
 
+QRect Primitive::rect() const
+{
+    return _rect;
+}
+
 Primitive::Type Primitive::type() const
 {
     return _type;
@@ -39,228 +171,428 @@ Primitive::Type Primitive::type() const
 
 QVector<QPoint> Primitive::args() const
 {
+    return argPoints().toVector();
+}
+
+Points Primitive::argPoints() const
+{
+    if (_store && _index >= 0)
+        return Points(_store->_arena.constData() + _store->_start[_index], _store->_count[_index]);
     return _args;
 }
 
+Points Primitive::shape() const
+{
+    return _shaped ? Points(_shape) : argPoints();
+}
+
+Ranges Primitive::ranges() const
+{
+    return _ranges;
+}
+
 QVector<QPoint> Primitive::points() const
 {
-    return _points;
+    QVector<QPoint> points;
+    VectorSink sink(points);
+    rasterize(sink);
+    return points;
 }
 
-void Primitive::setArgs(QVector<QPoint> args)
+// 分析器中按图元类型区分的阶段名称
+static const char *const rasterNames[] = {"raster/line", "raster/polygon", "raster/circle", "raster/ellipse", "raster/curve"};
+static const char *const fillNames[] = {"fill/line", "fill/polygon", "fill/circle", "fill/ellipse", "fill/curve"};
+
+const Spans &Primitive::spans() const
 {
-    _args = args;
-    setPoints(args);
-    int x = 0, y = 0;
-    foreach (QPoint p, args)
+    if (!_cached)
     {
-        x += p.x();
-        y += p.y();
+        ProfileScope scope(rasterNames[_type]);
+        QVector<QPoint> points;
+        VectorSink sink(points);
+        trace(sink);
+        _spans.build(points);
+        _cached = true;
+        scope.addPixels(_spans.pixels());
     }
-    _center = QPoint(x, y) / args.size();
+    return _spans;
 }
 
-void Primitive::setPoints(QVector<QPoint> args)
+void Primitive::prepare(const QTransform &view, QRect clip, Traced &traced) const
 {
-    switch (_type)
+    // 光栅化结果在首次使用时才生成，必须在分发到各块之前准备好
+    QTransform t = compose(view);
+    if (t.type() <= QTransform::TxTranslate)
     {
-    case Line:
-        _points = drawLine(args); break;
-    case Polygon:
-        _points = drawPolygon(args); break;
-    case Circle:
-        _points = drawCircle(args); break;
-    case Ellipse:
-        _points = drawEllipse(args); break;
-    case Curve:
-        _points = drawCurve(args); break;
+        spans();
+        if (filled())
+            fillSpans();
+        return;
+    }
+    if (tiny(view))
+        return;
+    // 缩放后按画布分辨率只光栅化一次，各块从中回放自己的扫描线；放大后只光栅化clip附近，留出描边的宽度
+    QVector<QPoint> args = map(shape(), t);
+    int w = qMax(1, qRound(_pen.width() * view.m11()));
+    {
+        ProfileScope scope(rasterNames[_type]);
+        QVector<QPoint> points;
+        VectorSink sink(points);
+        trace(args, sink, clip.adjusted(-w, -w, w, w));
+        traced.stroke.build(points);
+        scope.addPixels(traced.stroke.pixels());
+    }
+    if (filled())
+    {
+        ProfileScope scope(fillNames[_type]);
+        QVector<QLine> runs;
+        RunSink sink(runs);
+        traceFill(args, sink, clip);
+        traced.fill.build(runs);
+        scope.addPixels(traced.fill.pixels());
     }
 }
 
-QVector<QPoint> Primitive::drawLine(QVector<QPoint> args)
+bool Primitive::arcs(QPoint c, int rx, int ry, QRect clip, Ranges &ranges) const
 {
-    int x1 = args[0].x(), y1 = args[0].y(), x2 = args[1].x(), y2 = args[1].y();
-    int dx = qAbs(x2 - x1), sx = x1 < x2 ? 1 : -1;
-    int dy = qAbs(y2 - y1), sy = y1 < y2 ? 1 : -1;
-    int err = (dx > dy ? dx : -dy) / 2, e;
-    QVector<QPoint> points;
-    while (x1 != x2 || y1 != y2)
+    // 窗口留出两个像素，中点算法的像素与理想曲线相差不到一个像素，取整后的区间端点不会漏掉clip内的像素
+    ranges = _shapeRanges;
+    if (clip.isNull())
+        return true;
+    QRect window = clip.adjusted(-2, -2, 2, 2), bound(c.x() - rx, c.y() - ry, 2 * rx + 1, 2 * ry + 1);
+    if (window.contains(bound))
+        return true;
+    if (!window.intersects(bound))
+        return false;
+    Ranges found = Clipper(window.topLeft(), window.bottomRight()).clipEllipse(c, qMax(rx, 1), qMax(ry, 1));
+    if (!ranges.isEmpty())
+        found = Clipper::intersect(found, ranges);
+    ranges = found;
+    return !ranges.isEmpty();
+}
+
+bool Primitive::tiny(const QTransform &view) const
+{
+    qreal s = view.m11();
+    return view.type() > QTransform::TxTranslate && _rect.width() * s <= 2 && _rect.height() * s <= 2;
+}
+
+void Primitive::draw(uchar *bits, int bpl, QImage::Format format, QRect clip, const QTransform &view,
+                     const Traced *traced) const
+{
+    // 接收器按32位像素写入，其他格式的画布不绘制，以免越界
+    if (!ImageSink::supports(format))
+        return;
+    QTransform t = compose(view);
+    QPen pen = _pen;
+    if (view.type() > QTransform::TxTranslate)
     {
-        points.append(QPoint(x1, y1));
-        e = err;
-        if (e > -dx) { err -= dy; x1 += sx; }
-        if (e < dy) { err += dx; y1 += sy; }
+        // 细节层次：缩小到不足两个像素的图元只画一个点，不再光栅化
+        if (tiny(view))
+        {
+            QPointF c = view.map(QPointF(_rect.left() + _rect.width() / 2.0, _rect.top() + _rect.height() / 2.0));
+            ImageSink sink(bits, bpl, format, clip, filled() ? _brush.color().rgba() : _pen.color().rgba());
+            sink.plot(qFloor(c.x()), qFloor(c.y()));
+            return;
+        }
+        pen.setWidth(qMax(1, qRound(_pen.width() * view.m11())));
     }
-    return points;
+    // 常见的像素格式每个图元只选择一次特化的绘制函数，其余格式走通用的接收器。
+    // 包围盒映射到屏幕后再放宽一个画笔宽度，完整落在clip内时写入不再逐点裁剪
+    QRect b = QRectF(view.map(QPointF(_rect.topLeft())), view.map(QPointF(_rect.bottomRight() + QPoint(1, 1))))
+                  .normalized().toAlignedRect();
+    int m = pen.width() + 2;
+    if (Kernel k = dispatch(format, !clip.contains(b.adjusted(-m, -m, m, m))))
+    {
+        (this->*k)(bits, bpl, clip, t, pen, traced);
+        return;
+    }
+    if (filled())
+    {
+        ImageSink sink(bits, bpl, format, clip, _brush.color().rgba());
+        fill(sink, t, clip, traced ? &traced->fill : nullptr);
+    }
+    ImageSink sink(bits, bpl, format, clip, pen.color().rgba());
+    stroke(sink, clip, t, pen, traced ? &traced->stroke : nullptr);
 }
 
-QVector<QPoint> Primitive::drawPolygon(QVector<QPoint> args)
+void Primitive::draw(Canvas &canvas, QRect clip) const
 {
-    QVector<QPoint> points;
-    int n = args.size();
-    for (int i = 0; i < n; ++i)
+    // 分带绘制时只回放clip附近的扫描线，大图元不必在每一带从头解码
+    if (filled())
     {
-        if (i == n - 1)
-            points.append(drawLine({args[n - 1], args[0]}));
-        else
-            points.append(drawLine({args[i], args[i + 1]}));
+        CanvasSink sink(canvas, _brush.color().rgb(), clip);
+        fill(sink, _transform, clip);
     }
-    return points;
+    CanvasSink sink(canvas, _pen.color().rgb(), clip);
+    stroke(sink, clip, _transform, _pen);
 }
 
-QVector<QPoint> Primitive::drawCircle(QVector<QPoint> args)
+template <QImage::Format Format, bool Clipped>
+void Primitive::kernel(uchar *bits, int bpl, QRect clip, const QTransform &t, const QPen &pen,
+                       const Traced *traced) const
 {
-    QVector<QPoint> points;
-    int cx = args[0].x(), cy = args[0].y(), r = qMin(qAbs(args[1].x()), qAbs(args[1].y()));
-    auto lambda = [&](int x, int y)
+    if (filled())
     {
-        points.append(QPoint(cx + x, cy + y));
-        points.append(QPoint(cx - x, cy + y));
-        points.append(QPoint(cx - x, cy - y));
-        points.append(QPoint(cx + x, cy - y));
-        points.append(QPoint(cx + y, cy + x));
-        points.append(QPoint(cx - y, cy + x));
-        points.append(QPoint(cx - y, cy - x));
-        points.append(QPoint(cx + y, cy - x));
-    };
-    int p = 1 - r, x = 0, y = r;
-    lambda(x, y);
-    while (x < y)
+        KernelSink<Format, Clipped> sink(bits, bpl, clip, _brush.color().rgba());
+        fill(sink, t, clip, traced ? &traced->fill : nullptr);
+    }
+    // 粗画笔仍经描边器合并区间，不逐点写方块
+    KernelSink<Format, Clipped> sink(bits, bpl, clip, pen.color().rgba());
+    stroke(sink, clip, t, pen, traced ? &traced->stroke : nullptr);
+}
+
+Primitive::Kernel Primitive::dispatch(QImage::Format format, bool clipped)
+{
+    if (format == QImage::Format_RGB32)
+        return clipped ? &Primitive::kernel<QImage::Format_RGB32, true> : &Primitive::kernel<QImage::Format_RGB32, false>;
+    if (format == QImage::Format_ARGB32_Premultiplied)
+        return clipped ? &Primitive::kernel<QImage::Format_ARGB32_Premultiplied, true>
+                       : &Primitive::kernel<QImage::Format_ARGB32_Premultiplied, false>;
+    return nullptr;
+}
+
+QTransform Primitive::compose(const QTransform &view) const
+{
+    // 圆和椭圆不随待定的旋转变化，只组合平移
+    if (view.isIdentity())
+        return _transform;
+    if ((_type == Circle || _type == Ellipse) && _transform.type() > QTransform::TxTranslate)
+        return view;
+    return _transform * view;
+}
+
+QBrush Primitive::brush() const
+{
+    return _brush;
+}
+
+Qt::FillRule Primitive::fillRule() const
+{
+    return _rule;
+}
+
+bool Primitive::filled() const
+{
+    // 裁剪后的圆弧和椭圆弧不再封闭，只描边
+    return _brush.style() != Qt::NoBrush &&
+            (_type == Polygon || ((_type == Circle || _type == Ellipse) && _shapeRanges.isEmpty()));
+}
+
+const Spans &Primitive::fillSpans() const
+{
+    if (!_fillCached)
     {
-        if (p < 0) {
-            p += 2 * x + 3;
-        }
-        else {
-            y--;
-            p += 2 * (x - y) + 5;
-        }
-        ++x;
-        lambda(x, y);
+        ProfileScope scope(fillNames[_type]);
+        QVector<QLine> runs;
+        RunSink sink(runs);
+        traceFill(shape(), sink);
+        _fill.build(runs);
+        _fillCached = true;
+        scope.addPixels(_fill.pixels());
     }
-    return points;
+    return _fill;
 }
 
-QVector<QPoint> Primitive::drawEllipse(QVector<QPoint> args)
+void Primitive::setBrush(const QBrush &brush, Qt::FillRule rule)
 {
-    QVector<QPoint> points;
-    int cx = args[0].x(), cy = args[0].y(), rx = qMax(qAbs(args[1].x()), 1), ry = qMax(qAbs(args[1].y()), 1);
-    auto lambda = [&](int x, int y)
+    _brush = brush;
+    _rule = rule;
+    _fill.clear();
+    _fillCached = false;
+}
+
+int Primitive::memory() const
+{
+    // 存储中的参数计入存储的共享数组，这里只算图元自己持有的部分
+    int bytes = int(sizeof(Primitive)) + (_args.capacity() + _shape.capacity()) * int(sizeof(QPoint));
+    bytes += _ranges.capacity() * int(sizeof(Ranges::value_type));
+    if (_shapeRanges.constData() != _ranges.constData())
+        bytes += _shapeRanges.capacity() * int(sizeof(Ranges::value_type));
+    return bytes + _spans.memory() + _fill.memory() - 2 * int(sizeof(Spans));
+}
+
+void Primitive::setArgs(QVector<QPoint> args)
+{
+    // 参数只存一份，写入前先判断光栅化参数是否变化
+    bool same = _transform.isIdentity() && shape() == args && _ranges == _shapeRanges;
+    qint64 x = 0, y = 0;
+    foreach (QPoint p, args)
     {
-        points.append(QPoint(cx + x, cy + y));
-        points.append(QPoint(cx - x, cy + y));
-        points.append(QPoint(cx - x, cy - y));
-        points.append(QPoint(cx + x, cy - y));
-    };
-    if (rx >= ry)
+        x += p.x();
+        y += p.y();
+    }
+    _center = args.isEmpty() ? QPoint() : QPoint(qRound(qreal(x) / args.size()), qRound(qreal(y) / args.size()));
+    if (_store)
+        _store->update(this, args);
+    else
+        _args = args;
+    _shaped = false;
+    _shape.clear();
+    _shapeRanges = _ranges;
+    if (!same)
+        reshape();
+}
+
+void Primitive::setRanges(const Ranges &ranges)
+{
+    _ranges = ranges;
+    setPoints(argPoints(), ranges);
+}
+
+bool Primitive::setPoints(Points args, const Ranges &ranges)
+{
+    // 裁剪预览时大部分图元不变，跳过重新光栅化
+    if (_transform.isIdentity() && args == shape() && ranges == _shapeRanges)
+        return false;
+    // 与图元参数相同时直接使用存储中的参数，不再复制一份
+    _shaped = args != argPoints();
+    _shape = _shaped ? args.toVector() : QVector<QPoint>();
+    _shapeRanges = ranges;
+    reshape();
+    return true;
+}
+
+void Primitive::reshape()
+{
+    ProfileScope scope("setPoints");
+    _spans.clear();
+    _cached = false;
+    _fill.clear();
+    _fillCached = false;
+    _transform.reset();
+    _rect = bound(shape());
+    if (_grid)
+        _grid->update(this);
+}
+
+void Primitive::setGrid(Grid *grid)
+{
+    _grid = grid;
+}
+
+QTransform Primitive::transform() const
+{
+    return _transform;
+}
+
+void Primitive::setTransform(const QTransform &t)
+{
+    _transform = t;
+    _rect = bound(t.isIdentity() ? shape() : Points(map(shape(), t)));
+    if (_grid)
+        _grid->update(this);
+}
+
+void Primitive::commit()
+{
+    if (!_transform.isIdentity())
+        setArgs(map(argPoints(), _transform));
+}
+
+QVector<QPoint> Primitive::map(Points args, const QTransform &t) const
+{
+    QVector<QPoint> result = args.toVector();
+    if (_type == Circle || _type == Ellipse)
     {
-        int rx2 = rx * rx, ry2 = ry * ry;
-        int p = ry2 - rx2 * ry + rx2, x = 0, y = ry;
-        lambda(x, y);
-        while (ry2 * x <= rx2 * y)
+        // 圆和椭圆的第二个参数是半径，只跟随平移移动中心，与translate和rotate的处理一致；
+        // 视口缩放时中心随之移动，半径按比例缩放
+        if (!result.isEmpty() && t.type() == QTransform::TxTranslate)
+            result[0] += QPoint(qRound(t.dx()), qRound(t.dy()));
+        else if (!result.isEmpty() && t.type() == QTransform::TxScale)
         {
-            if (p < 0)
-                p += ry2 * (3 + 2 * x);
-            else
-            {
-                p += ry2 * (3 + 2 * x) + rx2 * (2 - 2 * y);
-                --y;
-            }
-            ++x;
-            lambda(x, y);
+            QPointF c = t.map(QPointF(result[0]));
+            result[0] = QPoint(int(c.x()), int(c.y()));
+            result[1] = QPoint(qRound(result[1].x() * t.m11()), qRound(result[1].y() * t.m22()));
+        }
+    }
+    else
+        for (auto& arg : result)
+        {
+            QPointF p = t.map(QPointF(arg));
+            arg.rx() = int(p.x());
+            arg.ry() = int(p.y());
         }
-        p = int(ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1.0) * (y - 1.0) - 1.0 * rx2 * ry2);
-        while (y >= 0)
+    return result;
+}
+
+QRect Primitive::bound(Points args) const
+{
+    if (args.isEmpty())
+        return QRect();
+    QRect r;
+    if (_type == Circle || _type == Ellipse)
+    {
+        int rx = qAbs(args[1].x()), ry = qAbs(args[1].y());
+        if (_type == Circle)
+            rx = ry = qMin(rx, ry);
+        else
         {
-            if (p < 0)
-            {
-                p += ry2 * (2 + 2 * x) + rx2 * (3 - 2 * y);
-                ++x;
-            }
-            else
-            {
-                p += rx2 * (3 - 2 * y);
-            }
-            --y;
-            lambda(x, y);
+            rx = qMax(rx, 1);
+            ry = qMax(ry, 1);
         }
+        r = QRect(args[0] - QPoint(rx, ry), args[0] + QPoint(rx, ry));
     }
     else
     {
-        qSwap(args[0].rx(), args[0].ry());
-        qSwap(args[1].rx(), args[1].ry());
-        points = drawEllipse(args);
-        for (auto& p : points)
-            qSwap(p.rx(), p.ry());
+        // B样条曲线位于控制点的凸包内，控制点的包围盒同样适用于曲线
+        int l = args[0].x(), rt = l, t = args[0].y(), b = t;
+        foreach (QPoint p, args)
+        {
+            l = qMin(l, p.x());
+            rt = qMax(rt, p.x());
+            t = qMin(t, p.y());
+            b = qMax(b, p.y());
+        }
+        r = QRect(QPoint(l, t), QPoint(rt, b));
     }
+    int m = _pen.width() / 2 + 1;
+    return r.adjusted(-m, -m, m, m);
+}
+
+QVector<QPoint> Primitive::drawLine(QVector<QPoint> args)
+{
+    QVector<QPoint> points;
+    VectorSink sink(points);
+    Raster::line(args[0], args[1], sink);
+    return points;
+}
+
+QVector<QPoint> Primitive::drawPolygon(QVector<QPoint> args)
+{
+    QVector<QPoint> points;
+    VectorSink sink(points);
+    Raster::polygon(args, sink);
+    return points;
+}
+
+QVector<QPoint> Primitive::drawCircle(QVector<QPoint> args)
+{
+    QVector<QPoint> points;
+    VectorSink sink(points);
+    Raster::circle(args[0], qMin(qAbs(args[1].x()), qAbs(args[1].y())), sink);
+    return points;
+}
+
+QVector<QPoint> Primitive::drawEllipse(QVector<QPoint> args)
+{
+    QVector<QPoint> points;
+    VectorSink sink(points);
+    Raster::ellipse(args[0], qMax(qAbs(args[1].x()), 1), qMax(qAbs(args[1].y()), 1), sink);
     return points;
 }
 
 QVector<QPoint> Primitive::drawCurve(QVector<QPoint> args)
 {
     QVector<QPoint> points;
-    int n = args.size();
-    if (!n)
-        return points;
-    --n;
-    int k = 3, m = n + k + 1;
-    QVector<qreal> v(m + 1);
-    for (int i = 0; i <= m; ++i)
-        v[i] = qreal(i) / m;
-    std::function<qreal(int, int, qreal)> lambda;
-    lambda = [&](int i, int k, qreal u) -> qreal
-    {
-        if (!k)
-            return (v[i] <= u && u <= v[i + 1]) ? 1.0 : 0.0;
-        return (lambda(i, k - 1, u) * (u - v[i]) / (v[i + k] - v[i])) +
-                (lambda(i + 1, k - 1, u) * (v[i + k + 1] - u) / (v[i + k + 1] - v[i + 1]));
-    };
-    for (qreal u = v[k]; u <= v[n + 1]; u += 0.001)
-    {
-        qreal x = 0.0, y = 0.0;
-        for (int i = 0; i <= n; ++i)
-        {
-            qreal p = lambda(i, k, u);
-            x += p * args[i].x();
-            y += p * args[i].y();
-        }
-        points.append({int(x), int(y)});
-    }
-    /*
-    for (int i = 3; i < n; ++i)
-        for (qreal u = 0.0; u <= 1.0; u += 0.001)
-        {
-            qreal a = -u * u * u + 3 * u * u - 3 * u + 1;
-            qreal b = 3 * u * u * u - 6 * u * u + 4;
-            qreal c = -3 * u * u * u + 3 * u * u + 3 * u + 1;
-            qreal d = u * u * u;
-            int x = 1.0 / 6 * (a * args[i - 3].x() + b * args[i - 2].x() + c * args[i - 1].x() + d * args[i].x());
-            int y = 1.0 / 6 * (a * args[i - 3].y() + b * args[i - 2].y() + c * args[i - 1].y() + d * args[i].y());
-            points.append({x, y});
-        }*/
-    /*
-    std::function<qreal(int, int, qreal)> f;
-    f = [&](int n, int i, qreal u) -> qreal
-    {
-        if (!n)
-            return qreal(args[i].x());
-        return (1 - u) * f(n - 1, i, u) + u * f(n - 1, i + 1, u);
-    };
-    std::function<qreal(int, int, qreal)> g;
-    g = [&](int n, int i, qreal u) -> qreal
-    {
-        if (!n)
-            return qreal(args[i].y());
-        return (1 - u) * g(n - 1, i, u) + u * g(n - 1, i + 1, u);
-    };
-    for (qreal u = 0.0; u <= 1.0; u += 0.001)
-        points.append(QPoint(int(f(n - 1, 0, u)), int(g(n - 1, 0, u))));
-    */
+    VectorSink sink(points);
+    Raster::curve(args, sink);
     return points;
 }
 
 QVector<QPoint> Primitive::translate(QPoint pos)
 {
-    QVector<QPoint> args = _args;
+    QVector<QPoint> args = this->args();
     if (_type == Circle || _type == Ellipse)
         args[0] += pos;
     else
@@ -271,7 +603,7 @@ QVector<QPoint> Primitive::translate(QPoint pos)
 
 QVector<QPoint> Primitive::rotate(qreal r)
 {
-    QVector<QPoint> args = _args;
+    QVector<QPoint> args = this->args();
     qreal cosr = qCos(r), sinr = qSin(r);
     int dx, dy;
     if (_type != Circle && _type != Ellipse)
@@ -287,7 +619,7 @@ QVector<QPoint> Primitive::rotate(qreal r)
 
 QVector<QPoint> Primitive::scale(qreal s)
 {
-    QVector<QPoint> args = _args;
+    QVector<QPoint> args = this->args();
     if (_type == Circle || _type == Ellipse)
         args[1] *= s;
     else
@@ -298,64 +630,6 @@ QVector<QPoint> Primitive::scale(qreal s)
 
 QVector<QPoint> Primitive::clip(QPoint lt, QPoint rb)
 {
-    int l = qMin(lt.x(), rb.x()), r = qMax(lt.x(), rb.x()), t = qMin(lt.y(), rb.y()), b = qMax(lt.y(), rb.y());
-    QVector<QPoint> args = _args;
-    auto lambda = [=](int x, int y)
-    {
-        uint8_t code = 0;
-        if (y < t)
-            code |= 8;
-        if (y > b)
-            code |= 4;
-        if (x > r)
-            code |= 2;
-        if (x < l)
-            code |= 1;
-        return code;
-    };
-    if (_type == Line)
-    {
-        int x = 0, y = 0, x1 = args[0].x(), y1 = args[0].y(), x2 = args[1].x(), y2 = args[1].y();
-        uint8_t code1 = lambda(x1, y1), code2 = lambda(x2, y2), code;
-        while (code1 || code2)
-        {
-            if (code1 & code2)
-                break;
-            code = code1 ? code1 : code2;
-            if (1 & code)
-            {
-                x = l;
-                y = y1 + (y2 - y1) * (l - x1) / (x2 - x1);
-            }
-            else if (2 & code)
-            {
-                x = r;
-                y = y1 + (y2 - y1) * (r - x1) / (x2 - x1);
-            }
-            else if (4 & code)
-            {
-                y = b;
-                x = x1 + (x2 - x1) * (b - y1) / (y2 - y1);
-            }
-            else if (8 & code)
-            {
-                y = t;
-                x = x1 + (x2 - x1) * (t - y1) / (y2 - y1);
-            }
-            if (code == code1)
-            {
-                x1 = x;
-                y1 = y;
-                code1 = lambda(x1, y1);
-            }
-            else
-            {
-                x2 = x;
-                y2 = y;
-                code2 = lambda(x2, y2);
-            }
-        }
-        args = {{x1, y1}, {x2, y2}};
-    }
-    return args;
+    Clipper::Result c = Clipper(lt, rb).clip({this})[0];
+    return c.where == Clipper::Inside ? args() : c.args;
 }
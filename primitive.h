@@ -2,28 +2,68 @@
 #define PRIMITIVE_H
 
 #include <QPen>
+#include <QBrush>
 #include <QPoint>
+#include <QPointF>
+#include <QRect>
 #include <QVector>
 #include <QPainter>
+#include <QTransform>
 #include <QtMath>
 #include <QtAlgorithms>
 #include <QDebug>
 #include <functional>
+#include "raster.h"
+#include "spans.h"
+#include "stroker.h"
+
+class Grid;
+class Store;
+class Canvas;
 
 class Primitive
 {
 public:
     enum Type { Line, Polygon, Circle, Ellipse, Curve };
+    struct Traced	// 按视口缩放后的扫描线区间，分块绘制时各块共享，只在一次绘制中有效
+    {
+        Spans stroke;	// 中心线
+        Spans fill;		// 内部
+    };
     Primitive();
     Primitive(QPen pen, Type type, QVector<QPoint> args);
     QPen pen();		// 获取图元的点的颜色和大小
-    bool contain(QPoint p);	// 判断图元包含某点
+    bool contain(QPoint p, qreal tolerance = 5);	// 判断图元包含某点，与图元的距离小于tolerance时也算包含
     QPoint center() const;	// 获取图元中心
+    QRect rect() const;		// 获取图元包围盒，包含画笔宽度
     Type type() const;	// 获取图元类型
     QVector<QPoint> args() const;	// 获取图元参数
-    QVector<QPoint> points() const;	// 获取图元点集合
+    Points argPoints() const;		// 图元参数的只读视图，在存储中时指向共享数组，存储修改参数后失效
+    Ranges ranges() const;			// 获取曲线裁剪后可见的参数区间，为空表示整条曲线可见
+    QVector<QPoint> points() const;	// 获取图元点集合，按需生成
+    const Spans &spans() const;		// 获取图元的扫描线区间，首次使用时光栅化
+    int memory() const;				// 图元占用的字节数
+    template <typename Sink> void rasterize(Sink &sink) const;	// 把缓存的扫描线区间交给接收器
+    template <typename Sink> void trace(Sink &sink) const;		// 运行光栅化算法，把像素交给接收器
+    template <typename Sink> void stroke(Sink &sink, QRect clip = QRect()) const;	// 按画笔宽度和端点形状描边，只输出clip内的像素
+    template <typename Sink> void fill(Sink &sink) const;	// 把内部的区间交给接收器，没有填充时不输出
+    void prepare(const QTransform &view, QRect clip, Traced &traced) const;	// 分块绘制前准备光栅化结果，不缩放时生成缓存，缩放时把clip附近光栅化到traced
+    void draw(uchar *bits, int bpl, QImage::Format format, QRect clip, const QTransform &view = QTransform(),
+              const Traced *traced = nullptr) const;	// 先填充再描边，经视口变换后写入32位画布的clip区域，traced为prepare的结果
+    void draw(Canvas &canvas, QRect clip) const;	// 先填充再描边，写入分块画布的clip区域
+    QBrush brush() const;			// 获取填充画刷，NoBrush表示不填充
+    Qt::FillRule fillRule() const;	// 获取多边形的填充规则
+    bool filled() const;			// 是否需要填充，只有多边形和完整的圆、椭圆可以填充
+    const Spans &fillSpans() const;	// 获取内部的扫描线区间，首次使用时生成
+    void setBrush(const QBrush &brush, Qt::FillRule rule = Qt::OddEvenFill);	// 设置填充画刷和填充规则
     void setArgs(QVector<QPoint> args);	// 设置图元参数
-    void setPoints(QVector<QPoint> args);	// 设置图元点集合
+    void setRanges(const Ranges &ranges);	// 设置曲线可见的参数区间
+    bool setPoints(Points args, const Ranges &ranges = Ranges());	// 设置光栅化使用的参数，与当前相同时返回false
+    void setGrid(Grid *grid);	// 设置所在的空间索引，由Grid调用
+    QTransform transform() const;				// 获取待定变换
+    void setTransform(const QTransform &t);		// 设置拖动时的待定变换，只在绘制时应用，不重新光栅化
+    void commit();								// 把待定变换写入图元参数
+    QVector<QPoint> map(Points args, const QTransform &t) const;	// 对参数应用变换
     static QVector<QPoint> drawLine(QVector<QPoint> args);		// 绘制直线
     static QVector<QPoint> drawPolygon(QVector<QPoint> args);	// 绘制多边形
     static QVector<QPoint> drawCircle(QVector<QPoint> args);	// 绘制圆形
@@ -32,13 +72,202 @@ public:
     QVector<QPoint> translate(QPoint pos);		// 平移
     QVector<QPoint> rotate(qreal r);			// 旋转
     QVector<QPoint> scale(qreal s);				// 缩放
-    QVector<QPoint> clip(QPoint lt, QPoint rb);	// 裁剪
+    QVector<QPoint> clip(QPoint lt, QPoint rb);	// 裁剪，完全在窗口外时返回空参数
 private:
+    friend class Store;
+    QRect bound(Points args) const;	// 根据参数计算包围盒
+    Points shape() const;			// 光栅化使用的参数
+    void reshape();					// 光栅化参数变化后清空缓存并更新包围盒
+    template <typename Sink> void trace(Points args, Sink &sink, QRect clip = QRect()) const;	// clip不为空时圆和椭圆只跟踪clip附近的圆弧
+    template <typename Sink> void traceFill(Points args, Sink &sink, QRect clip = QRect()) const;	// clip不为空时圆和椭圆只填充clip内的行
+    bool arcs(QPoint c, int rx, int ry, QRect clip, Ranges &ranges) const;	// 求clip附近可见的参数角区间，完全不可见时返回false
+    template <typename Sink> void rasterize(Sink &sink, const QTransform &t, QRect clip = QRect(),
+                                           const Spans *traced = nullptr) const;	// 只输出clip内的扫描线，变换后有traced时直接回放
+    template <typename Sink> void fill(Sink &sink, const QTransform &t, QRect clip = QRect(), const Spans *traced = nullptr) const;
+    template <typename Sink> void stroke(Sink &sink, QRect clip, const QTransform &t, const QPen &pen,
+                                         const Spans *traced = nullptr) const;
+    template <typename Sink> static void replay(const Spans &spans, Sink &sink, QRect clip);	// 回放clip内的扫描线，clip为空时全部回放
+    QTransform compose(const QTransform &view) const;	// 待定变换与视口变换的组合
+    bool tiny(const QTransform &view) const;			// 视口缩小后不足两个像素，只画一个点
+    typedef void (Primitive::*Kernel)(uchar *bits, int bpl, QRect clip, const QTransform &t, const QPen &pen,
+                                      const Traced *traced) const;
+    template <QImage::Format Format, bool Clipped>
+    void kernel(uchar *bits, int bpl, QRect clip, const QTransform &t, const QPen &pen,
+                const Traced *traced) const;	// 像素格式特化的填充和描边
+    static Kernel dispatch(QImage::Format format, bool clipped);	// 选择特化的绘制函数，没有对应特化时返回空
     QPen _pen;	// 点的颜色和大小
     Type _type;	// 图元类型，属于直线、多边形、圆形、椭圆、曲线之一
     QPoint _center;	// 图元中心，用于旋转和缩放
-    QVector<QPoint> _args;	// 图元参数
-    QVector<QPoint> _points;	// 图元点集
+    QVector<QPoint> _args;	// 不在存储中时的图元参数，在存储中时参数只放在存储的共享数组里，这里为空
+    Ranges _ranges;			// 曲线可见的参数区间
+    QVector<QPoint> _shape;	// 裁剪预览时光栅化使用的参数，与图元参数相同时为空
+    bool _shaped;			// 光栅化是否使用单独的参数
+    Ranges _shapeRanges;	// 光栅化使用的参数区间
+    mutable Spans _spans;	// 光栅化结果
+    mutable bool _cached;	// 光栅化结果是否有效
+    QBrush _brush;			// 填充画刷
+    Qt::FillRule _rule;		// 多边形填充规则，奇偶或非零环绕
+    mutable Spans _fill;	// 填充区间
+    mutable bool _fillCached;	// 填充区间是否有效
+    QTransform _transform;	// 待定变换，提交前只影响绘制
+    QRect _rect;	// 图元包围盒
+    Grid *_grid;	// 所在的空间索引
+    Store *_store;	// 所在的图元存储
+    int _index;		// 在图元存储结构数组中的位置，-1表示不在存储中，-2表示已放回但尚未并入
+    quint64 _order;	// 在图元存储中的顺序号，取下后保留，放回时回到原来的位置
 };
 
+template <typename Sink>
+void Primitive::rasterize(Sink &sink) const
+{
+    rasterize(sink, _transform);
+}
+
+template <typename Sink>
+void Primitive::rasterize(Sink &sink, const QTransform &t, QRect clip, const Spans *traced) const
+{
+    switch (t.type())
+    {
+    case QTransform::TxNone:
+        replay(spans(), sink, clip);
+        break;
+    case QTransform::TxTranslate:
+    {
+        // 平移只需在输出时偏移已缓存的区间
+        int dx = qRound(t.dx()), dy = qRound(t.dy());
+        OffsetSink<Sink> moved(sink, dx, dy);
+        replay(spans(), moved, clip.translated(-dx, -dy));
+        break;
+    }
+    default:
+        if (traced)
+            replay(*traced, sink, clip);
+        else
+            trace(map(shape(), t), sink, clip);
+        break;
+    }
+}
+
+template <typename Sink>
+void Primitive::stroke(Sink &sink, QRect clip) const
+{
+    stroke(sink, clip, _transform, _pen);
+}
+
+template <typename Sink>
+void Primitive::stroke(Sink &sink, QRect clip, const QTransform &t, const QPen &pen, const Spans *traced) const
+{
+    if (pen.width() <= 1)
+    {
+        rasterize(sink, t, clip, traced);
+        return;
+    }
+    // clip内的像素来自四周一个画笔宽度内的中心线
+    Stroker<Sink> stroker(sink, pen, clip);
+    int w = pen.width();
+    rasterize(stroker, t, clip.isNull() ? clip : clip.adjusted(-w, -w, w, w), traced);
+    stroker.finish();
+}
+
+template <typename Sink>
+void Primitive::fill(Sink &sink) const
+{
+    fill(sink, _transform);
+}
+
+template <typename Sink>
+void Primitive::fill(Sink &sink, const QTransform &t, QRect clip, const Spans *traced) const
+{
+    if (!filled())
+        return;
+    switch (t.type())
+    {
+    case QTransform::TxNone:
+        replay(fillSpans(), sink, clip);
+        break;
+    case QTransform::TxTranslate:
+    {
+        int dx = qRound(t.dx()), dy = qRound(t.dy());
+        OffsetSink<Sink> moved(sink, dx, dy);
+        replay(fillSpans(), moved, clip.translated(-dx, -dy));
+        break;
+    }
+    default:
+        if (traced)
+            replay(*traced, sink, clip);
+        else
+            traceFill(map(shape(), t), sink, clip);
+        break;
+    }
+}
+
+template <typename Sink>
+void Primitive::replay(const Spans &spans, Sink &sink, QRect clip)
+{
+    if (clip.isNull())
+        spans.replay(sink);
+    else
+        spans.replay(sink, clip.top(), clip.bottom());
+}
+
+template <typename Sink>
+void Primitive::trace(Sink &sink) const
+{
+    trace(shape(), sink);
+}
+
+template <typename Sink>
+void Primitive::trace(Points args, Sink &sink, QRect clip) const
+{
+    if (args.isEmpty())
+        return;
+    Ranges ranges;
+    switch (_type)
+    {
+    case Line:
+        Raster::line(args[0], args[1], sink); break;
+    case Polygon:
+        Raster::polygon(args, sink); break;
+    case Circle:
+    {
+        int r = qMin(qAbs(args[1].x()), qAbs(args[1].y()));
+        if (arcs(args[0], r, r, clip, ranges))
+            Raster::circle(args[0], r, sink, ranges);
+        break;
+    }
+    case Ellipse:
+    {
+        int rx = qMax(qAbs(args[1].x()), 1), ry = qMax(qAbs(args[1].y()), 1);
+        if (arcs(args[0], rx, ry, clip, ranges))
+            Raster::ellipse(args[0], rx, ry, sink, ranges);
+        break;
+    }
+    case Curve:
+        Raster::curve(args, sink, _shapeRanges); break;
+    }
+}
+
+template <typename Sink>
+void Primitive::traceFill(Points args, Sink &sink, QRect clip) const
+{
+    if (args.isEmpty())
+        return;
+    int top = clip.isNull() ? INT_MIN : clip.top(), bottom = clip.isNull() ? INT_MAX : clip.bottom();
+    switch (_type)
+    {
+    case Polygon:
+        Raster::fillPolygon(args, _rule, sink); break;
+    case Circle:
+    {
+        int r = qMin(qAbs(args[1].x()), qAbs(args[1].y()));
+        Raster::fillEllipse(args[0], r, r, sink, top, bottom);
+        break;
+    }
+    case Ellipse:
+        Raster::fillEllipse(args[0], qMax(qAbs(args[1].x()), 1), qMax(qAbs(args[1].y()), 1), sink, top, bottom); break;
+    default:
+        break;
+    }
+}
+
 #endif // PRIMITIVE_H
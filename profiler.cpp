@@ -0,0 +1,122 @@
+#include "profiler.h"
+#include <QFile>
+#include <QElapsedTimer>
+
+static const int maxEvents = 1 << 20;	// 记录的阶段数上限，超出后不再记录
+
+std::atomic<bool> Profiler::_enabled(false);
+QMutex Profiler::_mutex;
+QVector<Profiler::Event> Profiler::_events;
+qint64 Profiler::_frameStart = 0, Profiler::_frameTime = 0, Profiler::_pixels = 0, Profiler::_framePixels = 0;
+
+static bool fail(QString *error, const QString &message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+// 每个线程第一次记录时分配一个序号，作为trace中的tid
+static int threadIndex()
+{
+    static std::atomic<int> next(0);
+    thread_local int index = next++;
+    return index;
+}
+
+void Profiler::setEnabled(bool on)
+{
+    if (on && !enabled())
+        clear();
+    _enabled = on;
+}
+
+qint64 Profiler::now()
+{
+    static QElapsedTimer clock = []()
+    {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return clock.nsecsElapsed();
+}
+
+void Profiler::record(const char *name, qint64 start, qint64 end, qint64 pixels)
+{
+    int thread = threadIndex();
+    QMutexLocker locker(&_mutex);
+    _pixels += pixels;
+    if (_events.size() < maxEvents)
+        _events.append({name, start, end, pixels, thread});
+}
+
+void Profiler::beginFrame()
+{
+    QMutexLocker locker(&_mutex);
+    _frameStart = now();
+    _pixels = 0;
+}
+
+void Profiler::endFrame()
+{
+    QMutexLocker locker(&_mutex);
+    _frameTime = now() - _frameStart;
+    _framePixels = _pixels;
+}
+
+qint64 Profiler::frameTime()
+{
+    QMutexLocker locker(&_mutex);
+    return _frameTime;
+}
+
+qint64 Profiler::framePixels()
+{
+    QMutexLocker locker(&_mutex);
+    return _framePixels;
+}
+
+int Profiler::size()
+{
+    QMutexLocker locker(&_mutex);
+    return _events.size();
+}
+
+void Profiler::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _events.clear();
+    _frameTime = _framePixels = _pixels = 0;
+}
+
+bool Profiler::save(const QString &file, QString *error)
+{
+    // 每个阶段是一个完整事件(ph为X)，时间单位为微秒
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly))
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    QMutexLocker locker(&_mutex);
+    QByteArray buffer = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool ok = true;
+    for (int i = 0; i < _events.size(); ++i)
+    {
+        const Event &e = _events[i];
+        buffer += QByteArray(i ? ",\n" : "") + "{\"name\":\"" + e.name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" +
+                QByteArray::number(e.thread) + ",\"ts\":" + QByteArray::number(e.start / 1000.0, 'f', 3) +
+                ",\"dur\":" + QByteArray::number((e.end - e.start) / 1000.0, 'f', 3);
+        if (e.pixels)
+            buffer += ",\"args\":{\"pixels\":" + QByteArray::number(e.pixels) + "}";
+        buffer += "}";
+        if (buffer.size() >= 65536)
+        {
+            ok = f.write(buffer) == buffer.size() && ok;
+            buffer.clear();
+        }
+    }
+    buffer += "\n]}\n";
+    ok = f.write(buffer) == buffer.size() && ok;
+    if (!ok)
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+
+// 帧分析器：作用域对象记录各阶段的起止时刻和像素数，可以导出为Chrome trace-event JSON，
+// 用chrome://tracing或Perfetto查看。关闭时作用域对象只读取一个标志，不取时间也不加锁
+class Profiler
+{
+public:
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }	// 是否正在记录
+    static void setEnabled(bool on);	// 开始或停止记录，开始时清空已有记录
+    static qint64 now();				// 自程序启动以来的纳秒数
+    static void record(const char *name, qint64 start, qint64 end, qint64 pixels);	// 记录一个阶段，name必须是字符串常量
+    static void beginFrame();			// 开始一帧，之后记录的像素数计入本帧
+    static void endFrame();				// 结束一帧，更新帧耗时和像素数
+    static qint64 frameTime();			// 上一帧耗时，单位纳秒
+    static qint64 framePixels();		// 上一帧各叶子阶段的像素数之和，外层阶段不计像素，嵌套时不重复计数
+    static int size();					// 已记录的阶段数
+    static void clear();				// 清空记录
+    static bool save(const QString &file, QString *error = nullptr);	// 导出为Chrome trace-event JSON
+private:
+    struct Event
+    {
+        const char *name;		// 阶段名称
+        qint64 start, end;		// 起止时刻
+        qint64 pixels;			// 处理的像素数，0表示不适用
+        int thread;				// 线程序号
+    };
+    static std::atomic<bool> _enabled;
+    static QMutex _mutex;
+    static QVector<Event> _events;
+    static qint64 _frameStart, _frameTime, _pixels, _framePixels;
+};
+
+// 作用域内的耗时记为一个阶段，只有叶子阶段附加像素数，包含其他阶段的作用域不要调用addPixels
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name)
+        : _name(name), _start(Profiler::enabled() ? Profiler::now() : -1), _pixels(0) {}
+    ~ProfileScope()
+    {
+        if (_start >= 0)
+            Profiler::record(_name, _start, Profiler::now(), _pixels);
+    }
+    void addPixels(qint64 n) { _pixels += n; }
+private:
+    Q_DISABLE_COPY(ProfileScope)
+    const char *_name;
+    qint64 _start;		// 开始时刻，-1表示未记录
+    qint64 _pixels;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,762 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <QPen>
+#include <QRect>
+#include <QImage>
+#include <QPoint>
+#include <QLine>
+#include <QPointF>
+#include <QVector>
+#include <QPair>
+#include <QtMath>
+#include <climits>
+#include <algorithm>
+
+// 光栅化算法只负责生成像素坐标，像素交给接收器处理，
+// 接收器需提供plot(x, y)绘制单个像素，以及span(y, l, r)绘制一行中连续的像素
+
+// 参数区间列表，裁剪后的曲线只绘制区间内的部分，为空表示整条曲线
+typedef QVector<QPair<qreal, qreal>> Ranges;
+
+// 参数点的只读视图，指向QVector或图元存储的共享数组，不复制也不分配内存，底层数组修改后失效
+class Points
+{
+public:
+    Points() : _data(nullptr), _size(0) {}
+    Points(const QPoint *data, int size) : _data(data), _size(size) {}
+    Points(const QVector<QPoint> &args) : _data(args.constData()), _size(args.size()) {}
+    int size() const { return _size; }
+    bool isEmpty() const { return !_size; }
+    const QPoint &operator[](int i) const { return _data[i]; }
+    const QPoint *begin() const { return _data; }
+    const QPoint *end() const { return _data + _size; }
+    QVector<QPoint> toVector() const { QVector<QPoint> v(_size); std::copy(begin(), end(), v.begin()); return v; }
+    bool operator==(const Points &o) const { return _size == o._size && std::equal(begin(), end(), o.begin()); }
+    bool operator!=(const Points &o) const { return !(*this == o); }
+private:
+    const QPoint *_data;
+    int _size;
+};
+
+// 把像素追加到点集中，兼容原来返回QVector<QPoint>的接口
+class VectorSink
+{
+public:
+    explicit VectorSink(QVector<QPoint> &points) : _points(points) {}
+    void plot(int x, int y) { _points.append(QPoint(x, y)); }
+    void span(int y, int l, int r) { for (int x = l; x <= r; ++x) plot(x, y); }
+private:
+    QVector<QPoint> &_points;
+};
+
+// 把区间追加到区间列表中，填充结果按区间缓存
+class RunSink
+{
+public:
+    explicit RunSink(QVector<QLine> &runs) : _runs(runs) {}
+    void plot(int x, int y) { span(y, x, x); }
+    void span(int y, int l, int r) { _runs.append(QLine(l, y, r, y)); }
+private:
+    QVector<QLine> &_runs;
+};
+
+// 只统计像素个数，不保存像素
+class CountSink
+{
+public:
+    CountSink() : _count(0) {}
+    void plot(int, int) { ++_count; }
+    void span(int, int l, int r) { _count += r - l + 1; }
+    int count() const { return _count; }
+private:
+    int _count;
+};
+
+// 直接把像素写入32位画布，一像素宽，裁剪到给定区域，整行区间用std::fill写入，编译器会展开为向量存储。
+// 粗画笔由描边器合并各行区间后交给这里，接收器本身不按画笔宽度扩展。每个像素按quint32写入，
+// 只能用于supports()为真的格式，其他位深的画布会越界
+class ImageSink
+{
+public:
+    static bool supports(QImage::Format format)		// 像素是否为32位ARGB
+    {
+        return format == QImage::Format_RGB32 || format == QImage::Format_ARGB32 ||
+                format == QImage::Format_ARGB32_Premultiplied;
+    }
+    ImageSink(QImage &image, QRect clip, QRgb color)
+    {
+        init(image.bits(), image.bytesPerLine(), image.format(), clip & image.rect(), color);
+    }
+    // 裁剪区域必须位于画布内，多线程绘制时由调用者预先取得像素指针
+    ImageSink(uchar *bits, int bpl, QImage::Format format, QRect clip, QRgb color)
+    {
+        init(bits, bpl, format, clip, color);
+    }
+    void plot(int x, int y) { fill(y, x, x); }
+    void span(int y, int l, int r) { fill(y, l, r); }
+    void fill(int y, int l, int r)
+    {
+        if (y < _t || y > _b)
+            return;
+        quint32 *line = reinterpret_cast<quint32 *>(_bits + y * _bpl);
+        l = qMax(l, _l);
+        r = qMin(r, _r);
+        if (l <= r)
+            std::fill(line + l, line + r + 1, _color);
+    }
+private:
+    void init(uchar *bits, int bpl, QImage::Format format, QRect clip, QRgb color)
+    {
+        Q_ASSERT(supports(format));
+        _bits = bits;
+        _bpl = bpl;
+        _l = clip.left();
+        _t = clip.top();
+        _r = clip.right();
+        _b = clip.bottom();
+        _color = format == QImage::Format_ARGB32_Premultiplied ? qPremultiply(color) : (color | 0xff000000);
+    }
+    uchar *_bits;		// 画布像素
+    int _bpl;			// 每行字节数
+    int _l, _t, _r, _b;	// 裁剪区域
+    quint32 _color;		// 画笔颜色
+};
+
+// 像素格式在编译期确定的一像素宽接收器：颜色在构造时换算，写入时不再判断格式。
+// 粗画笔由描边器合并各行区间后经fill写入，每个像素只写一次。
+// 图元整体位于裁剪区域内时Clipped为false，写入时不再逐点比较边界
+template <QImage::Format Format, bool Clipped = true>
+class KernelSink
+{
+public:
+    KernelSink(uchar *bits, int bpl, QRect clip, QRgb color)
+        : _bits(bits), _bpl(bpl), _l(clip.left()), _t(clip.top()), _r(clip.right()), _b(clip.bottom()),
+          _color(Format == QImage::Format_ARGB32_Premultiplied ? qPremultiply(color) : (color | 0xff000000)) {}
+    void plot(int x, int y)
+    {
+        if (!Clipped || (x >= _l && x <= _r && y >= _t && y <= _b))
+            line(y)[x] = _color;
+    }
+    void span(int y, int l, int r) { fill(y, l, r); }
+    void fill(int y, int l, int r)
+    {
+        if (Clipped)
+        {
+            if (y < _t || y > _b)
+                return;
+            l = qMax(l, _l);
+            r = qMin(r, _r);
+        }
+        if (l <= r)
+            std::fill(line(y) + l, line(y) + r + 1, _color);
+    }
+private:
+    quint32 *line(int y) const { return reinterpret_cast<quint32 *>(_bits + y * _bpl); }
+    uchar *_bits;		// 画布像素
+    int _bpl;			// 每行字节数
+    int _l, _t, _r, _b;	// 裁剪区域
+    quint32 _color;		// 换算为画布格式的颜色
+};
+
+// 交换像素的横纵坐标后转交给另一个接收器，用于椭圆长轴在纵向时的对称处理
+template <typename Sink>
+class SwapSink
+{
+public:
+    explicit SwapSink(Sink &sink) : _sink(sink) {}
+    void plot(int x, int y) { _sink.plot(y, x); }
+    void span(int y, int l, int r) { for (int x = l; x <= r; ++x) _sink.plot(y, x); }
+private:
+    Sink &_sink;
+};
+
+// 平移像素后转交给另一个接收器，用于拖动时直接复用已缓存的光栅化结果
+template <typename Sink>
+class OffsetSink
+{
+public:
+    OffsetSink(Sink &sink, int dx, int dy) : _sink(sink), _dx(dx), _dy(dy) {}
+    void plot(int x, int y) { _sink.plot(x + _dx, y + _dy); }
+    void span(int y, int l, int r) { _sink.span(y + _dy, l + _dx, r + _dx); }
+private:
+    Sink &_sink;
+    int _dx, _dy;
+};
+
+class Raster
+{
+public:
+    template <typename Sink> static void line(QPoint a, QPoint b, Sink &sink);						// 直线
+    template <typename Sink> static void polygon(Points args, Sink &sink);		// 多边形
+    template <typename Sink> static void circle(QPoint c, int r, Sink &sink,
+                                                const Ranges &ranges = Ranges());				// 圆形，只绘制角度区间内的圆弧
+    template <typename Sink> static void ellipse(QPoint c, int rx, int ry, Sink &sink,
+                                                 const Ranges &ranges = Ranges());				// 椭圆，只绘制参数角区间内的椭圆弧
+    template <typename Sink> static void curve(Points args, Sink &sink,
+                                               const Ranges &ranges = Ranges());				// 曲线，只绘制参数区间内的部分
+    template <typename Sink> static void fillPolygon(Points args, Qt::FillRule rule,
+                                                     Sink &sink);								// 填充多边形内部，支持奇偶和非零环绕规则
+    template <typename Sink> static void fillEllipse(QPoint c, int rx, int ry, Sink &sink, int top = INT_MIN,
+                                                     int bottom = INT_MAX);						// 填充椭圆内部的top到bottom行，圆形的两个半径相等
+    template <typename F> static void sections(Points args, const Ranges &ranges, F f);	// 依次处理区间内的贝塞尔曲线段
+    static void bezier(Points args, int i, QPointF b[4]);	// 曲线第i段转换为贝塞尔控制点
+    static void split(const QPointF b[4], QPointF l[4], QPointF r[4]);		// 在中点把贝塞尔曲线分为两段
+    static void split(const QPointF b[4], qreal t, QPointF l[4], QPointF r[4]);	// 在参数t处把贝塞尔曲线分为两段
+    static void section(const QPointF b[4], qreal t0, qreal t1, QPointF s[4]);	// 取出贝塞尔曲线参数t0到t1的部分
+private:
+    template <typename Sink> static void wideEllipse(int cx, int cy, int rx, int ry, Sink &sink,
+                                                     const Ranges &ranges);						// 长轴在横向的椭圆
+    template <typename Plot> static void circleArc(int r, int xa, int xb, Plot plot);			// 八分圆中x在xa到xb之间的部分
+    template <typename Plot> static void ellipseArc(int rx, int ry, int xa, int xb, int ya, int yb, Plot plot);	// 四分之一椭圆的一段
+    static int circleY(int r, int x);					// 中点算法走到x时的y
+    static int ellipseY(int rx, int ry, int x);			// 椭圆中点算法第一段走到x时的y
+    static bool local(const QPair<qreal, qreal> &range, int k, qreal size, qreal &v0, qreal &v1);	// 区间在第k个扇区内的局部角度
+    template <typename Sink> static void flatten(const QPointF b[4], QPoint &last, Sink &sink, int depth);	// 自适应细分贝塞尔曲线
+};
+
+template <typename Sink>
+void Raster::line(QPoint a, QPoint b, Sink &sink)
+{
+    int x1 = a.x(), y1 = a.y(), x2 = b.x(), y2 = b.y();
+    int dx = qAbs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int dy = qAbs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int err = (dx > dy ? dx : -dy) / 2, e;
+    while (x1 != x2 || y1 != y2)
+    {
+        sink.plot(x1, y1);
+        e = err;
+        if (e > -dx) { err -= dy; x1 += sx; }
+        if (e < dy) { err += dx; y1 += sy; }
+    }
+}
+
+template <typename Sink>
+void Raster::polygon(Points args, Sink &sink)
+{
+    int n = args.size();
+    for (int i = 0; i < n; ++i)
+        line(args[i], args[i == n - 1 ? 0 : i + 1], sink);
+}
+
+template <typename Sink>
+void Raster::circle(QPoint c, int r, Sink &sink, const Ranges &ranges)
+{
+    int cx = c.x(), cy = c.y();
+    if (!ranges.isEmpty())
+    {
+        // 圆弧：每个八分圆中可见部分对应连续的一段x，只从该段起点开始运行中点算法
+        for (int k = 0; k < 8; ++k)
+        {
+            auto plot = [&](int x, int y)
+            {
+                switch (k)
+                {
+                case 0: sink.plot(cx + y, cy + x); break;
+                case 1: sink.plot(cx + x, cy + y); break;
+                case 2: sink.plot(cx - x, cy + y); break;
+                case 3: sink.plot(cx - y, cy + x); break;
+                case 4: sink.plot(cx - y, cy - x); break;
+                case 5: sink.plot(cx - x, cy - y); break;
+                case 6: sink.plot(cx + x, cy - y); break;
+                case 7: sink.plot(cx + y, cy - x); break;
+                }
+            };
+            qreal v0, v1;
+            foreach (auto range, ranges)
+                if (local(range, k, M_PI_4, v0, v1))
+                    circleArc(r, v0 <= 0 ? 0 : qRound(r * qSin(v0)),
+                              v1 >= M_PI_4 ? INT_MAX : qRound(r * qSin(v1)), plot);
+        }
+        return;
+    }
+    auto lambda = [&](int x, int y)
+    {
+        sink.plot(cx + x, cy + y);
+        sink.plot(cx - x, cy + y);
+        sink.plot(cx - x, cy - y);
+        sink.plot(cx + x, cy - y);
+        sink.plot(cx + y, cy + x);
+        sink.plot(cx - y, cy + x);
+        sink.plot(cx - y, cy - x);
+        sink.plot(cx + y, cy - x);
+    };
+    int p = 1 - r, x = 0, y = r;
+    lambda(x, y);
+    while (x < y)
+    {
+        if (p < 0) {
+            p += 2 * x + 3;
+        }
+        else {
+            y--;
+            p += 2 * (x - y) + 5;
+        }
+        ++x;
+        lambda(x, y);
+    }
+}
+
+template <typename Plot>
+void Raster::circleArc(int r, int xa, int xb, Plot plot)
+{
+    // 与circle的迭代完全一致，起点不在x=0时由判别式的闭式直接求出y和p
+    int x, y;
+    qint64 p;
+    if (xa <= 0)
+    {
+        x = 0;
+        y = r;
+        p = 1 - r;
+        plot(x, y);
+    }
+    else
+    {
+        x = xa - 1;
+        y = circleY(r, x);
+        if (x >= y)
+            return;
+        p = qint64(x + 1) * (x + 1) + qint64(y) * y - 3 * y - qint64(r) * r + 2 * r;
+    }
+    while (x < y && x < xb)
+    {
+        if (p < 0)
+            p += 2 * x + 3;
+        else
+        {
+            y--;
+            p += 2 * (x - y) + 5;
+        }
+        ++x;
+        plot(x, y);
+    }
+}
+
+template <typename Sink>
+void Raster::ellipse(QPoint c, int rx, int ry, Sink &sink, const Ranges &ranges)
+{
+    if (rx >= ry)
+        wideEllipse(c.x(), c.y(), rx, ry, sink, ranges);
+    else
+    {
+        // 交换坐标后参数角t变为π/2-t
+        Ranges swapped;
+        for (int i = ranges.size() - 1; i >= 0; --i)
+        {
+            qreal a = M_PI_2 - ranges[i].second, b = M_PI_2 - ranges[i].first;
+            if (a < 0)
+            {
+                swapped.append(qMakePair(a + 2 * M_PI, qMin(b + 2 * M_PI, 2 * M_PI)));
+                if (b > 0)
+                    swapped.append(qMakePair(0.0, b));
+            }
+            else
+                swapped.append(qMakePair(a, b));
+        }
+        SwapSink<Sink> sink2(sink);
+        wideEllipse(c.y(), c.x(), ry, rx, sink2, swapped);
+    }
+}
+
+template <typename Sink>
+void Raster::wideEllipse(int cx, int cy, int rx, int ry, Sink &sink, const Ranges &ranges)
+{
+    if (!ranges.isEmpty())
+    {
+        // 椭圆弧：每个四分之一椭圆中可见部分在第一段对应连续的一段x，在第二段对应连续的一段y
+        for (int k = 0; k < 4; ++k)
+        {
+            auto plot = [&](int x, int y)
+            {
+                switch (k)
+                {
+                case 0: sink.plot(cx + x, cy + y); break;
+                case 1: sink.plot(cx - x, cy + y); break;
+                case 2: sink.plot(cx - x, cy - y); break;
+                case 3: sink.plot(cx + x, cy - y); break;
+                }
+            };
+            qreal v0, v1;
+            foreach (auto range, ranges)
+                if (local(range, k, M_PI_2, v0, v1))
+                {
+                    // 局部参数角v从x轴量起，v越大x越小、y越大
+                    int xa = v1 >= M_PI_2 ? 0 : qRound(rx * qCos(v1)), xb = v0 <= 0 ? INT_MAX : qRound(rx * qCos(v0));
+                    int ya = v0 <= 0 ? INT_MIN : qRound(ry * qSin(v0)), yb = v1 >= M_PI_2 ? INT_MAX : qRound(ry * qSin(v1));
+                    ellipseArc(rx, ry, xa, xb, ya, yb, plot);
+                }
+        }
+        return;
+    }
+    auto lambda = [&](int x, int y)
+    {
+        sink.plot(cx + x, cy + y);
+        sink.plot(cx - x, cy + y);
+        sink.plot(cx - x, cy - y);
+        sink.plot(cx + x, cy - y);
+    };
+    // 放大后半径可达上千像素，rx2 * ry等项超出int，判别式用64位整数
+    qint64 rx2 = qint64(rx) * rx, ry2 = qint64(ry) * ry;
+    qint64 p = ry2 - rx2 * ry + rx2;
+    int x = 0, y = ry;
+    lambda(x, y);
+    while (ry2 * x <= rx2 * y)
+    {
+        if (p < 0)
+            p += ry2 * (3 + 2 * x);
+        else
+        {
+            p += ry2 * (3 + 2 * x) + rx2 * (2 - 2 * y);
+            --y;
+        }
+        ++x;
+        lambda(x, y);
+    }
+    p = qint64(ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1.0) * (y - 1.0) - 1.0 * rx2 * ry2);
+    while (y >= 0)
+    {
+        if (p < 0)
+        {
+            p += ry2 * (2 + 2 * x) + rx2 * (3 - 2 * y);
+            ++x;
+        }
+        else
+        {
+            p += rx2 * (3 - 2 * y);
+        }
+        --y;
+        lambda(x, y);
+    }
+}
+
+template <typename Plot>
+void Raster::ellipseArc(int rx, int ry, int xa, int xb, int ya, int yb, Plot plot)
+{
+    // 与wideEllipse的迭代完全一致，只是直接跳到可见部分的起点
+    qint64 rx2 = qint64(rx) * rx, ry2 = qint64(ry) * ry;
+    auto state = [&](int x, int &y, qint64 &p)
+    {
+        y = x ? ellipseY(rx, ry, x) : ry;
+        p = x ? ry2 * (x + 1) * (x + 1) + rx2 * (qint64(y) * y - y + 1) - rx2 * ry2 : ry2 - rx2 * ry + rx2;
+    };
+    auto step = [&](int &x, int &y, qint64 &p)
+    {
+        if (p < 0)
+            p += ry2 * (3 + 2 * x);
+        else
+        {
+            p += ry2 * (3 + 2 * x) + rx2 * (2 - 2 * y);
+            --y;
+        }
+        ++x;
+    };
+    // 第一段
+    int x, y;
+    qint64 p;
+    if (xa <= 0)
+    {
+        x = 0;
+        state(x, y, p);
+        plot(x, y);
+    }
+    else
+    {
+        x = xa - 1;
+        state(x, y, p);
+    }
+    if (ry2 * x <= rx2 * y)
+        while (ry2 * x <= rx2 * y && x < xb)
+        {
+            step(x, y, p);
+            plot(x, y);
+        }
+    if (ya >= y)
+        return;
+    // 找到第一段的终点，即第二段的起点
+    x = qMax(int(rx2 / qSqrt(rx2 + ry2)) - 2, 0);
+    state(x, y, p);
+    while (x > 0 && ry2 * x > rx2 * y)
+        state(x = qMax(x - 4, 0), y, p);
+    while (ry2 * x <= rx2 * y)
+        step(x, y, p);
+    int xs = x, ys = y;
+    qint64 ps = qint64(ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1.0) * (y - 1.0) - 1.0 * rx2 * ry2);
+    auto decision = [&](int x, int y)
+    {
+        return ps + ry2 * (qint64(x) * x + x - qint64(xs) * xs - xs) +
+                rx2 * ((qint64(y) - 1) * (y - 1) - (qint64(ys) - 1) * (ys - 1));
+    };
+    // 第二段：y从ys-1逐行减小，跳到y = yb + 1的状态
+    p = ps;
+    if (yb < ys - 2)
+    {
+        y = yb + 1;
+        qreal v = (qreal(rx2) * ry2 - qreal(rx2) * y * y) / ry2;
+        x = qMax(xs, int(qSqrt(qMax(v, 0.0))) - 2);
+        while (decision(x, y + 1) < 0)
+            ++x;
+        while (x > xs && decision(x - 1, y + 1) >= 0)
+            --x;
+        p = decision(x, y);
+    }
+    while (y >= 0 && y > ya)
+    {
+        if (p < 0)
+        {
+            p += ry2 * (2 + 2 * x) + rx2 * (3 - 2 * y);
+            ++x;
+        }
+        else
+            p += rx2 * (3 - 2 * y);
+        --y;
+        if (y <= yb)
+            plot(x, y);
+    }
+}
+
+inline int Raster::circleY(int r, int x)
+{
+    // circle的判别式在每次y减小时多加2，不变式为 p = (x+1)^2 + y^2 - 3y - r^2 + 2r，
+    // 走到x时的y是满足 x^2 + y^2 - 3y + 2r - r^2 < 0 的最大值
+    qint64 c = qint64(x) * x + 2 * r - qint64(r) * r;
+    int y = qMin(r, int((3 + qSqrt(qMax(9.0 - 4.0 * c, 0.0))) / 2) + 1);
+    while (y > 1 && qint64(y) * y - 3 * y + c >= 0)
+        --y;
+    return y;
+}
+
+inline int Raster::ellipseY(int rx, int ry, int x)
+{
+    // 第一段的不变式为 p = ry^2 (x+1)^2 + rx^2 (y^2 - y + 1) - rx^2 ry^2，
+    // 走到x时的y是满足 rx^2 (y^2 - y + 1) < rx^2 ry^2 - ry^2 x^2 的最大值
+    qint64 rx2 = qint64(rx) * rx, ry2 = qint64(ry) * ry, rhs = rx2 * ry2 - ry2 * x * x;
+    int y = qMin(ry, int((1 + qSqrt(qMax(4.0 * rhs / rx2 - 3, 0.0))) / 2) + 2);
+    while (y > 0 && rx2 * (qint64(y) * y - y + 1) >= rhs)
+        --y;
+    return y;
+}
+
+inline bool Raster::local(const QPair<qreal, qreal> &range, int k, qreal size, qreal &v0, qreal &v1)
+{
+    // 第k个扇区覆盖角度k*size到(k+1)*size，偶数扇区从起始边量起，奇数扇区从终止边量起
+    qreal a = qMax(range.first, k * size), b = qMin(range.second, (k + 1) * size);
+    if (a >= b)
+        return false;
+    v0 = k % 2 ? (k + 1) * size - b : a - k * size;
+    v1 = k % 2 ? (k + 1) * size - a : b - k * size;
+    return true;
+}
+
+template <typename Sink>
+void Raster::curve(Points args, Sink &sink, const Ranges &ranges)
+{
+    // 均匀三次B样条每段都是一条三次贝塞尔曲线，按平直度自适应细分，细分点之间用直线连接
+    QPoint last;
+    bool started = false;
+    sections(args, ranges, [&](const QPointF b[4], bool first)
+    {
+        if (first)
+        {
+            if (started)
+                sink.plot(last.x(), last.y());
+            last = b[0].toPoint();
+            started = true;
+        }
+        flatten(b, last, sink, 16);
+    });
+    if (started)
+        sink.plot(last.x(), last.y());
+}
+
+template <typename F>
+void Raster::sections(Points args, const Ranges &ranges, F f)
+{
+    // 曲线参数u取值0到n-3，整数部分是段号，小数部分是段内参数；f的第二个参数表示是否开始一段新的连续曲线
+    int n = args.size() - 3;
+    QPointF b[4], s[4];
+    if (ranges.isEmpty())
+    {
+        for (int k = 0; k < n; ++k)
+        {
+            bezier(args, k + 3, b);
+            f(b, k == 0);
+        }
+        return;
+    }
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        qreal u0 = qBound(0.0, ranges[i].first, qreal(qMax(n, 0))), u1 = qBound(0.0, ranges[i].second, qreal(qMax(n, 0)));
+        for (int k = int(u0); k < n && k < u1; ++k)
+        {
+            bezier(args, k + 3, b);
+            section(b, qMax(u0 - k, 0.0), qMin(u1 - k, 1.0), s);
+            f(s, k == int(u0));
+        }
+    }
+}
+
+template <typename Sink>
+void Raster::flatten(const QPointF b[4], QPoint &last, Sink &sink, int depth)
+{
+    qreal ux = 3 * b[1].x() - 2 * b[0].x() - b[3].x(), uy = 3 * b[1].y() - 2 * b[0].y() - b[3].y();
+    qreal vx = 3 * b[2].x() - b[0].x() - 2 * b[3].x(), vy = 3 * b[2].y() - b[0].y() - 2 * b[3].y();
+    // 曲线与弦的偏差不超过半个像素时直接连线
+    if (!depth || qMax(ux * ux, vx * vx) + qMax(uy * uy, vy * vy) <= 4)
+    {
+        QPoint p = b[3].toPoint();
+        if (p != last)
+        {
+            line(last, p, sink);
+            last = p;
+        }
+        return;
+    }
+    QPointF l[4], r[4];
+    split(b, l, r);
+    flatten(l, last, sink, depth - 1);
+    flatten(r, last, sink, depth - 1);
+}
+
+inline void Raster::bezier(Points args, int i, QPointF b[4])
+{
+    // 均匀三次B样条第i段（控制点i-3到i）等价的贝塞尔控制点
+    QPointF p0 = args[i - 3], p1 = args[i - 2], p2 = args[i - 1], p3 = args[i];
+    b[0] = (p0 + p1 * 4 + p2) / 6;
+    b[1] = (p1 * 2 + p2) / 3;
+    b[2] = (p1 + p2 * 2) / 3;
+    b[3] = (p1 + p2 * 4 + p3) / 6;
+}
+
+inline void Raster::split(const QPointF b[4], QPointF l[4], QPointF r[4])
+{
+    QPointF m01 = (b[0] + b[1]) / 2, m12 = (b[1] + b[2]) / 2, m23 = (b[2] + b[3]) / 2;
+    QPointF m012 = (m01 + m12) / 2, m123 = (m12 + m23) / 2, m = (m012 + m123) / 2;
+    l[0] = b[0]; l[1] = m01; l[2] = m012; l[3] = m;
+    r[0] = m; r[1] = m123; r[2] = m23; r[3] = b[3];
+}
+
+inline void Raster::split(const QPointF b[4], qreal t, QPointF l[4], QPointF r[4])
+{
+    QPointF m01 = b[0] + (b[1] - b[0]) * t, m12 = b[1] + (b[2] - b[1]) * t, m23 = b[2] + (b[3] - b[2]) * t;
+    QPointF m012 = m01 + (m12 - m01) * t, m123 = m12 + (m23 - m12) * t, m = m012 + (m123 - m012) * t;
+    l[0] = b[0]; l[1] = m01; l[2] = m012; l[3] = m;
+    r[0] = m; r[1] = m123; r[2] = m23; r[3] = b[3];
+}
+
+inline void Raster::section(const QPointF b[4], qreal t0, qreal t1, QPointF s[4])
+{
+    QPointF l[4], r[4];
+    if (t1 < 1)
+        split(b, t1, l, r);
+    else
+        for (int i = 0; i < 4; ++i)
+            l[i] = b[i];
+    if (t0 > 0 && t1 > 0)
+        split(l, t0 / t1, r, s);
+    else
+        for (int i = 0; i < 4; ++i)
+            s[i] = l[i];
+}
+
+template <typename Sink>
+void Raster::fillPolygon(Points args, Qt::FillRule rule, Sink &sink)
+{
+    // 活动边表扫描线填充：边按上端点排序，扫描线自上而下移动时加入到达的边、移除结束的边，
+    // 每条边覆盖[top, bottom)的扫描线，顶点处相接的两条边只计一次。交点按x排序后从左到右累计环绕数，
+    // 进入内部时记下起点，离开时输出像素中心落在内部的区间，凹多边形和自交多边形都能正确处理
+    struct Edge
+    {
+        int top, bottom, dir;	// 覆盖的扫描线，向下为1、向上为-1
+        qreal x0, dx, x;		// 上端点的x，每条扫描线的x增量，当前扫描线上的交点
+    };
+    int n = args.size();
+    if (n < 3)
+        return;
+    QVector<Edge> edges;
+    edges.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        QPoint a = args[i], b = args[(i + 1) % n];
+        if (a.y() == b.y())
+            continue;
+        int dir = a.y() < b.y() ? 1 : -1;
+        if (dir < 0)
+            qSwap(a, b);
+        edges.append({a.y(), b.y(), dir, qreal(a.x()), qreal(b.x() - a.x()) / (b.y() - a.y()), 0});
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.top < b.top; });
+    QVector<Edge> active;
+    int next = 0, y = 0;
+    while (next < edges.size() || !active.isEmpty())
+    {
+        if (active.isEmpty())
+            y = edges[next].top;
+        while (next < edges.size() && edges[next].top == y)
+            active.append(edges[next++]);
+        // 交点直接由上端点求出，不累积误差；相邻扫描线的交点顺序变化很小，插入排序接近线性
+        for (int i = 0; i < active.size(); ++i)
+        {
+            Edge e = active[i];
+            e.x = e.x0 + (y - e.top) * e.dx;
+            int j = i;
+            for (; j > 0 && active[j - 1].x > e.x; --j)
+                active[j] = active[j - 1];
+            active[j] = e;
+        }
+        int winding = 0, last = INT_MIN;
+        qreal start = 0;
+        for (int i = 0; i < active.size(); ++i)
+        {
+            int before = winding;
+            winding += rule == Qt::WindingFill ? active[i].dir : 1;
+            bool was = rule == Qt::WindingFill ? before != 0 : (before & 1);
+            bool now = rule == Qt::WindingFill ? winding != 0 : (winding & 1);
+            if (!was && now)
+                start = active[i].x;
+            else if (was && !now)
+            {
+                // 离开后在同一交点重新进入时，交点处的像素不重复输出
+                int l = qMax(qCeil(start), last + 1), r = qFloor(active[i].x);
+                if (l <= r)
+                {
+                    sink.span(y, l, r);
+                    last = r;
+                }
+            }
+        }
+        ++y;
+        int k = 0;
+        for (int i = 0; i < active.size(); ++i)
+            if (active[i].bottom > y)
+                active[k++] = active[i];
+        active.resize(k);
+    }
+}
+
+template <typename Sink>
+void Raster::fillEllipse(QPoint c, int rx, int ry, Sink &sink, int top, int bottom)
+{
+    // 每行取满足x²ry² + y²rx² <= rx²ry²的最大x，从中间行向外x单调不增，逐行递减即可，不必开方。
+    // 第c.y()+y行在范围内需要-up <= y <= down，第c.y()-y行需要-down <= y <= up，只走这些行，
+    // 第一行的x由开方估计后向下修正
+    qint64 rx2 = qint64(rx) * rx, ry2 = qint64(ry) * ry, limit = rx2 * ry2;
+    qint64 up = qint64(c.y()) - top, down = qint64(bottom) - c.y();
+    qint64 from = qMin(down >= 0 ? qMax<qint64>(0, -up) : LLONG_MAX, up >= 0 ? qMax<qint64>(0, -down) : LLONG_MAX);
+    qint64 to = qMin<qint64>(qMax(up, down), ry);
+    if (from > to)
+        return;
+    int x = from ? qMin(rx, int(rx * qSqrt(1.0 - qreal(from) * from / ry2)) + 2) : rx;
+    for (int y = int(from); y <= to; ++y)
+    {
+        while (x >= 0 && qint64(x) * x * ry2 + qint64(y) * y * rx2 > limit)
+            --x;
+        if (x < 0)
+            break;
+        if (y >= -up && y <= down)
+            sink.span(c.y() + y, c.x() - x, c.x() + x);
+        if (y && y >= -down && y <= up)
+            sink.span(c.y() - y, c.x() - x, c.x() + x);
+    }
+}
+
+#endif // RASTER_H
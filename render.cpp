@@ -0,0 +1,108 @@
+#include "scene.h"
+#include "exporter.h"
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QTextStream>
+#include <atomic>
+
+// 不依赖窗口的批量绘制工具：cg-render [-o 输出目录] [-j 线程数] [-f 格式] [-t 分析文件] 场景文件或目录...
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("cg-render");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render text scene files to images.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenes", "Scene files or directories of *.txt and *.cgs scenes.", "scenes...");
+    QCommandLineOption outputOption({"o", "output"}, "Output directory (default: next to each scene).", "dir");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of parallel jobs (default: one per core).", "n");
+    QCommandLineOption formatOption({"f", "format"}, "Image format, or svg/pdf for vector output; bmp is drawn in tiles and streamed (default: png).", "format", "png");
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    QCommandLineOption traceOption({"t", "trace"}, "Write a Chrome trace-event profile of loading, rendering and saving.", "file");
+    parser.addOption(formatOption);
+    parser.addOption(traceOption);
+    parser.process(a);
+
+    QTextStream err(stderr);
+    QStringList files;
+    foreach (QString arg, parser.positionalArguments())
+    {
+        QFileInfo info(arg);
+        if (info.isDir())
+            foreach (QFileInfo f, QDir(arg).entryInfoList({"*.txt", "*.cgs"}, QDir::Files, QDir::Name))
+                files.append(f.filePath());
+        else
+            files.append(arg);
+    }
+    if (files.isEmpty())
+        parser.showHelp(1);
+
+    QString output = parser.value(outputOption);
+    if (!output.isEmpty() && !QDir().mkpath(output))
+    {
+        err << "cannot create " << output << "\n";
+        return 1;
+    }
+    if (parser.isSet(jobsOption))
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(parser.value(jobsOption).toInt(), 1));
+    QString format = parser.value(formatOption);
+    Profiler::setEnabled(parser.isSet(traceOption));
+
+    // 每个场景是一个独立任务，场景内部串行绘制，避免线程嵌套
+    std::atomic<int> failed(0);
+    QElapsedTimer timer;
+    timer.start();
+    QtConcurrent::blockingMap(files, [&](const QString &file)
+    {
+        QFileInfo info(file);
+        QString target = (output.isEmpty() ? info.path() : output) + "/" + info.completeBaseName() + "." + format;
+        Scene scene;
+        QString error;
+        bool loaded;
+        {
+            ProfileScope scope("load");
+            loaded = scene.load(file, &error);
+        }
+        ProfileScope scope("output");
+        if (!loaded)
+            qWarning().noquote() << error;
+        else if (format == "svg" || format == "pdf")
+        {
+            if (!Exporter::save(target, scene.size(), scene.primitives(), &error))
+                qWarning().noquote() << error;
+            else
+                return;
+        }
+        else if (format == "bmp")
+        {
+            // BMP按块绘制、逐行输出，海报尺寸的场景不需要整张图片的内存
+            Canvas canvas(scene.size());
+            scene.paint(canvas);
+            if (!canvas.save(target, &error))
+                qWarning().noquote() << error;
+            else
+                return;
+        }
+        else if (!scene.render().save(target, format.toLatin1().constData()))
+            qWarning().noquote() << "cannot write" << target;
+        else
+            return;
+        ++failed;
+    });
+    qint64 ms = qMax<qint64>(timer.elapsed(), 1);
+    QString error;
+    if (parser.isSet(traceOption) && !Profiler::save(parser.value(traceOption), &error))
+        qWarning().noquote() << error;
+    int done = files.size() - failed;
+    err << done << " scenes in " << ms << " ms, " << done * 1000.0 / ms << " scenes/s with "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads" << "\n";
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+#include "renderer.h"
+#include "profiler.h"
+#include <QtConcurrent>
+
+static const int serialPixels = 256 * 256;	// 小于该面积的区域直接串行绘制
+
+Renderer::Renderer(int tile)
+    : _tile(tile)
+{
+
+}
+
+void Renderer::render(QImage &image, QRect r, const QVector<Primitive *> &scene, const Viewport &view) const
+{
+    r &= image.rect();
+    if (r.isEmpty() || scene.isEmpty())
+        return;
+    // 画布指针只在主线程获取一次，避免各线程调用bits()时检查隐式共享
+    uchar *bits = image.bits();
+    int bpl = image.bytesPerLine();
+    QImage::Format format = image.format();
+    QTransform t = view.transform();
+    if (r.width() * r.height() < serialPixels || QThreadPool::globalInstance()->maxThreadCount() < 2)
+    {
+        foreach (Primitive *p, scene)
+            p->draw(bits, bpl, format, r, t);
+        return;
+    }
+    int cols = (r.width() + _tile - 1) / _tile, rows = (r.height() + _tile - 1) / _tile;
+    QVector<Tile> tiles(cols * rows);
+    for (int j = 0; j < rows; ++j)
+        for (int i = 0; i < cols; ++i)
+            tiles[j * cols + i].rect = QRect(r.left() + i * _tile, r.top() + j * _tile, _tile, _tile) & r;
+    // 跨越多块的图元先并行准备光栅化结果，缩放时的结果在各块之间共享；只在一块内的图元由该块自己光栅化
+    QVector<int> shared;
+    QVector<Primitive::Traced> traced(scene.size());
+    QVector<const Primitive::Traced *> prepared(scene.size(), nullptr);
+    for (int k = 0; k < scene.size(); ++k)
+    {
+        QRect b = view.toScreen(scene[k]->rect()) & r;
+        if (b.isEmpty())
+            continue;
+        int l = (b.left() - r.left()) / _tile, t = (b.top() - r.top()) / _tile;
+        int rt = (b.right() - r.left()) / _tile, bt = (b.bottom() - r.top()) / _tile;
+        if (l != rt || t != bt)
+        {
+            shared.append(k);
+            prepared[k] = &traced[k];
+        }
+        for (int j = t; j <= bt; ++j)
+            for (int i = l; i <= rt; ++i)
+                tiles[j * cols + i].primitives.append(k);
+    }
+    QtConcurrent::blockingMap(shared, [&](int k)
+    {
+        scene[k]->prepare(t, r, traced[k]);
+    });
+    QtConcurrent::blockingMap(tiles, [&](const Tile &tile)
+    {
+        ProfileScope scope("tile");
+        foreach (int k, tile.primitives)
+            scene[k]->draw(bits, bpl, format, tile.rect, t, prepared[k]);
+    });
+}
@@ -0,0 +1,28 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "primitive.h"
+#include "viewport.h"
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// 分块并行绘制：把重绘区域切成小块，按包围盒把图元分到各块，各块在线程池中独立绘制。
+// 每块内图元按原顺序绘制且各块互不重叠，结果与串行绘制逐像素一致。
+// 各块只回放自己范围内的扫描线；视口缩放时每个图元先光栅化一次，各块共享结果
+class Renderer
+{
+public:
+    explicit Renderer(int tile = 128);
+    void render(QImage &image, QRect r, const QVector<Primitive *> &scene,
+                const Viewport &view = Viewport()) const;	// 把图元经视口变换后绘制到画布的指定区域
+private:
+    struct Tile
+    {
+        QRect rect;						// 块的范围
+        QVector<int> primitives;		// 与该块相交的图元在场景中的序号，保持原顺序
+    };
+    int _tile;	// 块的边长
+};
+
+#endif // RENDERER_H
@@ -0,0 +1,341 @@
+#include "scene.h"
+#include "clipper.h"
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+
+Scene::Scene()
+    : _size(800, 600)
+{
+
+}
+
+Scene::~Scene()
+{
+    clear();
+}
+
+static const char magic[4] = {'C', 'G', 'S', 'C'};	// 二进制场景文件标识
+static const qint32 version = 1;						// 二进制场景格式版本
+static const int headerSize = 28;						// 文件头字节数
+static const int hasRanges = 1;							// 图元记录标志：参数后附有曲线可见的参数区间
+static const int hasBrush = 2;							// 图元记录标志：末尾附有填充颜色和填充规则
+static const int roundPen = 0x10000;					// 画笔宽度中的标志：圆头画笔
+
+static bool fail(QString *error, const QString &message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+bool Scene::load(const QString &file, QString *error)
+{
+    clear();
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly))
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    bool ok = f.peek(4) == QByteArray(magic, 4) ? loadBinary(f, error) : loadText(f, error);
+    if (!ok)
+        clear();
+    return ok;
+}
+
+bool Scene::loadText(QFile &f, QString *error)
+{
+    QTextStream in(&f);
+    QPen pen(Qt::black, 3);
+    QBrush brush;
+    Qt::FillRule rule = Qt::OddEvenFill;
+    Primitive *last = nullptr;
+    for (int n = 1; !in.atEnd(); ++n)
+    {
+        QStringList words = in.readLine().simplified().split(' ');
+        if (words[0].isEmpty() || words[0].startsWith("#"))
+            continue;
+        QString cmd = words.takeFirst();
+        QVector<qreal> v;
+        bool ok = true;
+        if (cmd != "pen" && cmd != "brush")
+            foreach (QString w, words)
+                if (ok)
+                    v.append(w.toDouble(&ok));
+        QString where = QString("%1:%2: ").arg(f.fileName()).arg(n);
+        if (!ok)
+            return fail(error, where + "invalid number");
+        QVector<QPoint> args;
+        for (int i = 0; i + 1 < v.size(); i += 2)
+            args.append(QPoint(qRound(v[i]), qRound(v[i + 1])));
+        if (cmd == "size" && v.size() == 2)
+            _size = QSize(int(v[0]), int(v[1]));
+        else if (cmd == "pen" && (words.size() == 2 || (words.size() == 3 && words[2] == "round")))
+        {
+            pen = QPen(QColor(words[0]), words[1].toInt(&ok));
+            if (!ok || !pen.color().isValid())
+                return fail(error, where + "invalid pen");
+            if (words.size() == 3)
+                pen.setCapStyle(Qt::RoundCap);
+        }
+        else if (cmd == "brush" && words.size() == 1 && words[0] == "none")
+            brush = QBrush();
+        else if (cmd == "brush" && (words.size() == 1 || (words.size() == 2 && words[1] == "nonzero")))
+        {
+            brush = QBrush(QColor(words[0]));
+            if (!brush.color().isValid())
+                return fail(error, where + "invalid brush");
+            rule = words.size() == 2 ? Qt::WindingFill : Qt::OddEvenFill;
+        }
+        else if (cmd == "line" && v.size() == 4)
+            last = _store.create(pen, Primitive::Line, args);
+        else if (cmd == "polygon" && v.size() >= 6 && v.size() % 2 == 0)
+        {
+            last = _store.create(pen, Primitive::Polygon, args);
+            last->setBrush(brush, rule);
+        }
+        else if (cmd == "curve" && v.size() >= 8 && v.size() % 2 == 0)
+            last = _store.create(pen, Primitive::Curve, args);
+        else if (cmd == "circle" && v.size() == 3)
+        {
+            last = _store.create(pen, Primitive::Circle, {args[0], QPoint(qRound(v[2]), qRound(v[2]))});
+            last->setBrush(brush, rule);
+        }
+        else if (cmd == "ellipse" && v.size() == 4)
+        {
+            last = _store.create(pen, Primitive::Ellipse, args);
+            last->setBrush(brush, rule);
+        }
+        else if (cmd == "translate" && v.size() == 2 && last)
+            last->setArgs(last->translate(args[0]));
+        else if (cmd == "rotate" && v.size() == 1 && last)
+            last->setArgs(last->rotate(qDegreesToRadians(v[0])));
+        else if (cmd == "scale" && v.size() == 1 && last)
+            last->setArgs(last->scale(v[0]));
+        else if (cmd == "clip" && v.size() == 4)
+        {
+            foreach (const Clipper::Result &c, Clipper(args[0], args[1]).clip(_store.primitives()))
+            {
+                if (c.where == Clipper::Outside)
+                {
+                    if (last == c.primitive)
+                        last = nullptr;
+                    _store.destroy(c.primitive);
+                }
+                else if (c.where == Clipper::Clipped)
+                {
+                    c.primitive->setRanges(c.ranges);
+                    c.primitive->setArgs(c.args);
+                }
+            }
+        }
+        else
+            return fail(error, where + QString("invalid command '%1'").arg(cmd));
+    }
+    return true;
+}
+
+bool Scene::loadBinary(QFile &f, QString *error)
+{
+    // 直接从内存映射中解析，只保留图元参数，像素在第一次绘制时才生成
+    qint64 size = f.size();
+    const uchar *data = size >= headerSize ? f.map(0, size) : nullptr;
+    if (!data)
+        return fail(error, QString("%1: %2").arg(f.fileName()).arg(size < headerSize ? "truncated header" : f.errorString()));
+    auto word = [&](qint64 offset) { return qFromLittleEndian<qint32>(data + offset); };
+    QString message;
+    quint32 count = quint32(word(16)), pens = quint32(word(20));
+    qint64 penOffset = quint32(word(24));
+    if (word(4) != version)
+        message = "unsupported version";
+    else if (penOffset < headerSize || penOffset + qint64(pens) * 8 > size)
+        message = "invalid pen table";
+    else
+    {
+        _size = QSize(word(8), word(12));
+        QVector<QPen> table;
+        for (quint32 i = 0; i < pens; ++i)
+        {
+            int width = word(penOffset + i * 8 + 4);
+            table.append(QPen(QColor::fromRgba(QRgb(word(penOffset + i * 8))), width & 0xffff));
+            if (width & roundPen)
+                table.last().setCapStyle(Qt::RoundCap);
+        }
+        QVector<QPoint> args;
+        qint64 offset = headerSize;
+        // 各类图元绘制时至少需要的参数个数。编辑器中正在绘制的多边形和曲线、裁剪后只剩两个顶点的多边形
+        // 顶点都可能少于文本格式的要求，绘制和裁剪都能处理，读取时同样接受
+        static const int minArgs[] = {2, 0, 2, 2, 0};
+        for (quint32 i = 0; i < count && message.isEmpty(); ++i)
+        {
+            // 先确认记录头在图元区内再读取
+            if (offset + 12 > penOffset)
+            {
+                message = QString("invalid primitive %1").arg(i);
+                break;
+            }
+            int type = data[offset], flags = data[offset + 1];
+            quint32 pen = quint32(word(offset + 4));
+            qint64 n = quint32(word(offset + 8));
+            offset += 12;
+            if (type > Primitive::Curve || pen >= pens || n < minArgs[type] || offset + n * 8 > penOffset)
+            {
+                message = QString("invalid primitive %1").arg(i);
+                break;
+            }
+            args.resize(int(n));
+            for (int j = 0; j < n; ++j, offset += 8)
+                args[j] = QPoint(word(offset), word(offset + 4));
+            Primitive *p = _store.create(table[pen], Primitive::Type(type), args);
+            if (flags & hasRanges)
+            {
+                qint64 m = offset + 4 <= penOffset ? quint32(word(offset)) : -1;
+                offset += 4;
+                if (m < 0 || offset + m * 8 > penOffset)
+                {
+                    message = QString("invalid primitive %1").arg(i);
+                    break;
+                }
+                Ranges ranges;
+                for (int j = 0; j < m; ++j, offset += 8)
+                    ranges.append(qMakePair(word(offset) / 65536.0, word(offset + 4) / 65536.0));
+                p->setRanges(ranges);
+            }
+            if (flags & hasBrush)
+            {
+                if (offset + 8 > penOffset)
+                {
+                    message = QString("invalid primitive %1").arg(i);
+                    break;
+                }
+                p->setBrush(QBrush(QColor::fromRgba(QRgb(word(offset)))), word(offset + 4) ? Qt::WindingFill : Qt::OddEvenFill);
+                offset += 8;
+            }
+        }
+    }
+    f.unmap(const_cast<uchar *>(data));
+    return message.isEmpty() || fail(error, QString("%1: %2").arg(f.fileName()).arg(message));
+}
+
+bool Scene::save(const QString &file, QString *error) const
+{
+    return save(file, _size, _store, error);
+}
+
+bool Scene::save(const QString &file, QSize size, const Store &store, QString *error)
+{
+    // 图元记录边生成边写出，缓冲区满了就写入文件，不在内存中拼出整个文件
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly))
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    QByteArray buffer;
+    auto put = [&](qint32 v)
+    {
+        char bytes[4];
+        qToLittleEndian(v, bytes);
+        buffer.append(bytes, 4);
+    };
+    auto flush = [&]()
+    {
+        bool ok = f.write(buffer) == buffer.size();
+        buffer.clear();
+        return ok;
+    };
+    buffer.append(magic, 4);
+    put(version);
+    put(size.width());
+    put(size.height());
+    put(0);		// 图元数，写完后回填
+    put(0);		// 画笔数，写完后回填
+    put(0);		// 画笔表偏移，写完后回填
+    // 类型、画笔序号和参数直接从存储的结构数组中读取，画笔表与存储共用序号
+    // 编辑器新建多边形和曲线时预先放入的空图元不保存
+    const QList<Primitive *> &primitives = store.primitives();
+    bool ok = true;
+    int count = 0;
+    for (int i = 0; i < store.size(); ++i)
+    {
+        if (!store.argCount(i))
+            continue;
+        ++count;
+        Ranges ranges = primitives[i]->ranges();
+        QBrush brush = primitives[i]->brush();
+        bool filled = brush.style() != Qt::NoBrush;
+        buffer.append(char(store.type(i)));
+        buffer.append(char((ranges.isEmpty() ? 0 : hasRanges) | (filled ? hasBrush : 0)));
+        buffer.append(2, '\0');
+        put(store.pen(i));
+        put(store.argCount(i));
+        for (const QPoint *a = store.args(i), *end = a + store.argCount(i); a != end; ++a)
+        {
+            put(a->x());
+            put(a->y());
+        }
+        if (!ranges.isEmpty())
+        {
+            put(ranges.size());
+            foreach (auto range, ranges)
+            {
+                put(qRound(range.first * 65536));
+                put(qRound(range.second * 65536));
+            }
+        }
+        if (filled)
+        {
+            put(qint32(brush.color().rgba()));
+            put(primitives[i]->fillRule() == Qt::WindingFill ? 1 : 0);
+        }
+        if (buffer.size() >= 65536)
+            ok = flush() && ok;
+    }
+    qint64 penOffset = f.pos() + buffer.size();
+    foreach (const QPen &pen, store.pens())
+    {
+        put(qint32(pen.color().rgba()));
+        put(pen.width() | (pen.capStyle() == Qt::RoundCap ? roundPen : 0));
+    }
+    ok = flush() && ok;
+    put(count);
+    put(store.pens().size());
+    put(qint32(penOffset));
+    ok = ok && f.seek(16) && flush();
+    if (!ok)
+        return fail(error, QString("%1: %2").arg(file).arg(f.errorString()));
+    return true;
+}
+
+void Scene::take(Store &store)
+{
+    store.swap(_store);
+    _store.clear();
+}
+
+void Scene::clear()
+{
+    _store.clear();
+}
+
+QSize Scene::size() const
+{
+    return _size;
+}
+
+const QList<Primitive *> &Scene::primitives() const
+{
+    return _store.primitives();
+}
+
+QImage Scene::render() const
+{
+    QImage image(_size, QImage::Format_RGB32);
+    image.fill(Qt::white);
+    foreach (Primitive *p, _store.primitives())
+        p->draw(image.bits(), image.bytesPerLine(), image.format(), image.rect());
+    return image;
+}
+
+void Scene::paint(Canvas &canvas) const
+{
+    canvas.draw(_store.primitives());
+}
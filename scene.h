@@ -0,0 +1,57 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "primitive.h"
+#include "store.h"
+#include "canvas.h"
+#include <QImage>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QFile>
+
+// 不依赖窗口的场景：从文本或二进制文件读取图元和变换操作，绘制成图片
+//
+// 文本格式每行一条命令，#开头为注释：
+//   size w h                  画布大小
+//   pen #rrggbb width [round] 之后图元使用的画笔，round表示圆头
+//   line x1 y1 x2 y2          直线
+//   polygon x1 y1 x2 y2 ...   多边形
+//   circle cx cy r            圆形
+//   ellipse cx cy rx ry       椭圆
+//   curve x1 y1 x2 y2 ...     曲线
+//   translate dx dy           平移上一个图元
+//   rotate degrees            绕中心旋转上一个图元
+//   scale s                   绕中心缩放上一个图元
+//   clip l t r b              用矩形裁剪所有图元
+//
+// 二进制格式所有整数为小端序32位，记录按4字节对齐，可以直接从内存映射中读取：
+//   文件头   "CGSC" 版本 宽 高 图元数 画笔数 画笔表偏移
+//   图元记录 类型(1字节) 标志(1字节) 保留(2字节) 画笔序号 参数个数 参数(x y)...
+//            标志最低位为1时随后是区间个数和裁剪后曲线的参数区间(起点 终点)，以1/65536为单位
+//   画笔表   颜色(ARGB) 宽度(低16位，第16位为1表示圆头)
+// 画笔表放在文件末尾，写入时只需顺序输出图元，最后回填文件头
+class Scene
+{
+public:
+    Scene();
+    ~Scene();
+    bool load(const QString &file, QString *error = nullptr);		// 读取场景，根据文件头区分文本和二进制格式
+    bool save(const QString &file, QString *error = nullptr) const;	// 保存为二进制场景
+    static bool save(const QString &file, QSize size, const Store &store,
+                     QString *error = nullptr);						// 把存储中的图元保存为二进制场景
+    void take(Store &store);						// 把图元移交给另一个存储，存储中原有的图元被释放
+    void clear();									// 清空场景
+    QSize size() const;								// 画布大小
+    const QList<Primitive *> &primitives() const;	// 场景中的图元
+    QImage render() const;							// 绘制到白色背景的画布上
+    void paint(Canvas &canvas) const;				// 绘制到分块画布上，画布大小可以超过内存
+private:
+    Q_DISABLE_COPY(Scene)
+    bool loadText(QFile &f, QString *error);
+    bool loadBinary(QFile &f, QString *error);
+    QSize _size;
+    Store _store;
+};
+
+#endif // SCENE_H
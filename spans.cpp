@@ -0,0 +1,150 @@
+#include "spans.h"
+#include <algorithm>
+
+Spans::Spans()
+    : _top(0), _rows(0), _pixels(0)
+{
+
+}
+
+void Spans::build(QVector<QPoint> points)
+{
+    clear();
+    if (points.isEmpty())
+        return;
+    std::sort(points.begin(), points.end(), [](QPoint a, QPoint b)
+    {
+        return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+    });
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    _pixels = points.size();
+    _top = points.first().y();
+    _rows = points.last().y() - _top + 1;
+    int x = 0, i = 0, n = points.size();
+    for (int y = _top; y < _top + _rows; ++y)
+    {
+        mark(y, x);
+        // 先统计本行区间个数，再依次写出各区间
+        int j = i, count = 0;
+        while (j < n && points[j].y() == y)
+        {
+            int k = j + 1;
+            while (k < n && points[k].y() == y && points[k].x() == points[k - 1].x() + 1)
+                ++k;
+            ++count;
+            j = k;
+        }
+        write(_data, uint(count));
+        while (i < j)
+        {
+            int k = i + 1;
+            while (k < j && points[k].x() == points[k - 1].x() + 1)
+                ++k;
+            write(_data, zigzag(points[i].x() - x));
+            write(_data, uint(points[k - 1].x() - points[i].x()));
+            x = points[i].x();
+            i = k;
+        }
+    }
+    _data.squeeze();
+    _index.squeeze();
+}
+
+void Spans::build(QVector<QLine> runs)
+{
+    clear();
+    if (runs.isEmpty())
+        return;
+    std::sort(runs.begin(), runs.end(), [](const QLine &a, const QLine &b)
+    {
+        return a.y1() < b.y1() || (a.y1() == b.y1() && a.x1() < b.x1());
+    });
+    // 同一行中重叠或相接的区间合并为一个
+    int n = 0;
+    for (int i = 1; i < runs.size(); ++i)
+    {
+        QLine &last = runs[n];
+        if (runs[i].y1() == last.y1() && runs[i].x1() <= last.x2() + 1)
+            last = QLine(last.x1(), last.y1(), qMax(last.x2(), runs[i].x2()), last.y1());
+        else
+            runs[++n] = runs[i];
+    }
+    runs.resize(n + 1);
+    _top = runs.first().y1();
+    _rows = runs.last().y1() - _top + 1;
+    int x = 0, i = 0;
+    for (int y = _top; y < _top + _rows; ++y)
+    {
+        mark(y, x);
+        int j = i;
+        while (j <= n && runs[j].y1() == y)
+            ++j;
+        write(_data, uint(j - i));
+        for (; i < j; ++i)
+        {
+            write(_data, zigzag(runs[i].x1() - x));
+            write(_data, uint(runs[i].x2() - runs[i].x1()));
+            _pixels += runs[i].x2() - runs[i].x1() + 1;
+            x = runs[i].x1();
+        }
+    }
+    _data.squeeze();
+    _index.squeeze();
+}
+
+void Spans::clear()
+{
+    _top = _rows = _pixels = 0;
+    _data.clear();
+    _index.clear();
+}
+
+bool Spans::isEmpty() const
+{
+    return !_pixels;
+}
+
+int Spans::pixels() const
+{
+    return _pixels;
+}
+
+int Spans::memory() const
+{
+    return int(sizeof(Spans)) + _data.capacity() + _index.capacity() * int(sizeof(QPair<int, int>));
+}
+
+bool Spans::near(QPoint pos, int d) const
+{
+    const uchar *p = reinterpret_cast<const uchar *>(_data.constData());
+    int x = 0;
+    for (int y = _top, end = qMin(_top + _rows, pos.y() + d); y < end; ++y)
+    {
+        int dy = y - pos.y();
+        for (uint n = read(p); n; --n)
+        {
+            x += unzigzag(read(p));
+            int r = x + int(read(p));
+            int dx = pos.x() < x ? x - pos.x() : pos.x() > r ? pos.x() - r : 0;
+            if (dx * dx + dy * dy < d * d)
+                return true;
+        }
+    }
+    return false;
+}
+
+void Spans::mark(int y, int x)
+{
+    if ((y - _top) % indexStep == 0)
+        _index.append(qMakePair(_data.size(), x));
+}
+
+void Spans::write(QByteArray &data, uint v)
+{
+    while (v >= 0x80)
+    {
+        data.append(char(v | 0x80));
+        v >>= 7;
+    }
+    data.append(char(v));
+}
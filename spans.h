@@ -0,0 +1,85 @@
+#ifndef SPANS_H
+#define SPANS_H
+
+#include <QPoint>
+#include <QLine>
+#include <QVector>
+#include <QPair>
+#include <QByteArray>
+
+// 光栅化结果的紧凑存储：按扫描线合并为水平区间并去除重复像素，
+// 区间左端相对上一区间做差分后以变长整数编码，通常每个像素只需一到三个字节
+class Spans
+{
+public:
+    Spans();
+    void build(QVector<QPoint> points);	// 由像素构建，像素可以无序、重复
+    void build(QVector<QLine> runs);	// 由水平区间构建，区间可以无序、重叠，填充大面积时不必展开为像素
+    void clear();						// 清空
+    bool isEmpty() const;				// 是否没有像素
+    int pixels() const;					// 去重后的像素个数
+    int memory() const;					// 占用的字节数
+    bool near(QPoint pos, int d) const;	// 是否有像素与该点距离小于d
+    template <typename Sink> void replay(Sink &sink) const;	// 把区间依次交给接收器
+    template <typename Sink> void replay(Sink &sink, int top, int bottom) const;	// 只回放top到bottom之间的扫描线
+private:
+    static const int indexStep = 256;	// 每隔多少条扫描线记录一个解码起点
+    void mark(int y, int x);			// 在第y行开始处记录解码起点
+    static void write(QByteArray &data, uint v);
+    static uint read(const uchar *&p);
+    static uint zigzag(int v) { return (uint(v) << 1) ^ uint(v >> 31); }
+    static int unzigzag(uint v) { return int(v >> 1) ^ -int(v & 1); }
+    int _top;			// 第一条扫描线
+    int _rows;			// 扫描线条数
+    int _pixels;		// 像素个数
+    QByteArray _data;	// 编码后的区间
+    QVector<QPair<int, int>> _index;	// 每indexStep行的解码起点：在_data中的偏移和上一区间的左端
+};
+
+inline uint Spans::read(const uchar *&p)
+{
+    uint v = 0;
+    int shift = 0;
+    while (*p & 0x80)
+    {
+        v |= uint(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    return v | (uint(*p++) << shift);
+}
+
+template <typename Sink>
+void Spans::replay(Sink &sink) const
+{
+    const uchar *p = reinterpret_cast<const uchar *>(_data.constData());
+    int x = 0;
+    for (int y = _top, end = _top + _rows; y < end; ++y)
+        for (uint n = read(p); n; --n)
+        {
+            x += unzigzag(read(p));
+            sink.span(y, x, x + int(read(p)));
+        }
+}
+
+template <typename Sink>
+void Spans::replay(Sink &sink, int top, int bottom) const
+{
+    // 从top之前最近的起点开始解码，跳过的行不交给接收器
+    top = qMax(top, _top);
+    int end = qMin(bottom + 1, _top + _rows);
+    if (top >= end)
+        return;
+    int k = (top - _top) / indexStep;
+    const uchar *p = reinterpret_cast<const uchar *>(_data.constData()) + _index[k].first;
+    int x = _index[k].second;
+    for (int y = _top + k * indexStep; y < end; ++y)
+        for (uint n = read(p); n; --n)
+        {
+            x += unzigzag(read(p));
+            int r = x + int(read(p));
+            if (y >= top)
+                sink.span(y, x, r);
+        }
+}
+
+#endif // SPANS_H
@@ -0,0 +1,301 @@
+#include "store.h"
+#include <new>
+#include <algorithm>
+
+static const int blockSize = 256;	// 每块容纳的图元个数
+
+Store::Store()
+    : _holes(0), _next(0), _garbage(0)
+{
+
+}
+
+Store::~Store()
+{
+    clear();
+    foreach (Primitive *block, _blocks)
+        ::operator delete(block);
+}
+
+Primitive *Store::create(const QPen &pen, Primitive::Type type, const QVector<QPoint> &args)
+{
+    if (_free.isEmpty())
+    {
+        // 新块的槽位倒序放入空闲表，先分配低地址的槽位
+        Primitive *block = static_cast<Primitive *>(::operator new(blockSize * sizeof(Primitive)));
+        _blocks.append(block);
+        for (int i = blockSize - 1; i >= 0; --i)
+            _free.append(block + i);
+    }
+    Primitive *p = new (_free.takeLast()) Primitive(pen, type, args);
+    p->_store = this;
+    p->_order = _next++;
+    // 新图元的顺序号最大，直接追加到末尾仍然有序
+    append(p);
+    return p;
+}
+
+void Store::destroy(Primitive *p)
+{
+    if (!p || p->_store != this)
+        return;
+    detach(p);
+    p->~Primitive();
+    _free.append(p);
+}
+
+void Store::detach(Primitive *p)
+{
+    if (!contains(p))
+        return;
+    if (p->_index < 0)
+        settle();
+    int i = p->_index;
+    // 取下的图元由持有者保管，参数移回图元自己
+    p->_args = QVector<QPoint>(_count[i]);
+    std::copy(_arena.constBegin() + _start[i], _arena.constBegin() + _start[i] + _count[i], p->_args.begin());
+    _garbage += _count[i];
+    _count[i] = 0;
+    _order[i] = nullptr;
+    ++_holes;
+    p->_index = -1;
+    if (_holes == _order.size() && _attached.isEmpty())
+    {
+        _order.clear();
+        _types.clear();
+        _pens.clear();
+        _centers.clear();
+        _start.clear();
+        _count.clear();
+        _arena.clear();
+        _holes = _garbage = 0;
+    }
+    else if (_garbage > 1024 && _garbage > _arena.size() / 2)
+        compact();
+}
+
+void Store::attach(Primitive *p)
+{
+    if (!p || p->_store != this || p->_index != -1)
+        return;
+    p->_index = -2;
+    _attached.append(p);
+}
+
+bool Store::contains(const Primitive *p) const
+{
+    return p && p->_store == this && p->_index != -1;
+}
+
+void Store::append(Primitive *p)
+{
+    QPen pen = p->pen();
+    quint64 key = (quint64(pen.color().rgba()) << 32) | quint32(pen.width()) | (pen.capStyle() == Qt::RoundCap ? 0x80000000u : 0);
+    auto it = _penIndex.constFind(key);
+    if (it == _penIndex.constEnd())
+    {
+        it = _penIndex.insert(key, _penTable.size());
+        _penTable.append(pen);
+    }
+    // 参数移入共享数组，图元不再保留自己的副本
+    p->_index = _order.size();
+    _order.append(p);
+    _types.append(quint8(p->type()));
+    _pens.append(it.value());
+    _centers.append(p->center());
+    _start.append(_arena.size());
+    _count.append(p->_args.size());
+    _arena += p->_args;
+    p->_args = QVector<QPoint>();
+}
+
+void Store::settle()
+{
+    if (!_holes && _attached.isEmpty())
+        return;
+    // 留下的图元和放回的图元都按顺序号排列，归并一遍即可
+    std::sort(_attached.begin(), _attached.end(), [](const Primitive *a, const Primitive *b)
+    {
+        return a->_order < b->_order;
+    });
+    QList<Primitive *> order;
+    QVector<quint8> types;
+    QVector<int> pens, start, count;
+    QVector<QPoint> centers;
+    order.swap(_order);
+    types.swap(_types);
+    pens.swap(_pens);
+    centers.swap(_centers);
+    start.swap(_start);
+    count.swap(_count);
+    int n = order.size() - _holes + _attached.size();
+    _order.reserve(n);
+    _types.reserve(n);
+    _pens.reserve(n);
+    _centers.reserve(n);
+    _start.reserve(n);
+    _count.reserve(n);
+    int j = 0;
+    for (int i = 0; i <= order.size(); ++i)
+    {
+        Primitive *p = i < order.size() ? order[i] : nullptr;
+        if (!p && i < order.size())
+            continue;
+        while (j < _attached.size() && (!p || _attached[j]->_order < p->_order))
+            append(_attached[j++]);
+        if (!p)
+            break;
+        p->_index = _order.size();
+        _order.append(p);
+        _types.append(types[i]);
+        _pens.append(pens[i]);
+        _centers.append(centers[i]);
+        _start.append(start[i]);
+        _count.append(count[i]);
+    }
+    _attached.clear();
+    _holes = 0;
+}
+
+void Store::clear()
+{
+    settle();
+    foreach (Primitive *p, _order)
+    {
+        p->~Primitive();
+        _free.append(p);
+    }
+    _order.clear();
+    _types.clear();
+    _pens.clear();
+    _centers.clear();
+    _start.clear();
+    _count.clear();
+    _arena.clear();
+    _garbage = 0;
+    _penTable.clear();
+    _penIndex.clear();
+}
+
+void Store::swap(Store &other)
+{
+    _blocks.swap(other._blocks);
+    _free.swap(other._free);
+    _order.swap(other._order);
+    _attached.swap(other._attached);
+    qSwap(_holes, other._holes);
+    qSwap(_next, other._next);
+    _types.swap(other._types);
+    _pens.swap(other._pens);
+    _centers.swap(other._centers);
+    _start.swap(other._start);
+    _count.swap(other._count);
+    _arena.swap(other._arena);
+    qSwap(_garbage, other._garbage);
+    _penTable.swap(other._penTable);
+    _penIndex.swap(other._penIndex);
+    settle();
+    other.settle();
+    foreach (Primitive *p, _order)
+        p->_store = this;
+    foreach (Primitive *p, other._order)
+        p->_store = &other;
+}
+
+int Store::size() const
+{
+    settle();
+    return _order.size();
+}
+
+int Store::indexOf(const Primitive *p) const
+{
+    if (!contains(p))
+        return -1;
+    settle();
+    return p->_index;
+}
+
+const QList<Primitive *> &Store::primitives() const
+{
+    settle();
+    return _order;
+}
+
+Primitive::Type Store::type(int i) const
+{
+    settle();
+    return Primitive::Type(_types[i]);
+}
+
+int Store::pen(int i) const
+{
+    settle();
+    return _pens[i];
+}
+
+const QVector<QPen> &Store::pens() const
+{
+    settle();
+    return _penTable;
+}
+
+QPoint Store::center(int i) const
+{
+    settle();
+    return _centers[i];
+}
+
+const QPoint *Store::args(int i) const
+{
+    settle();
+    return _arena.constData() + _start[i];
+}
+
+int Store::argCount(int i) const
+{
+    settle();
+    return _count[i];
+}
+
+void Store::update(Primitive *p, const QVector<QPoint> &args)
+{
+    // 参数个数不增加时原地覆盖，否则追加到共享数组末尾，原来的位置作废
+    if (p->_index == -2)
+        settle();
+    int i = p->_index;
+    if (i < 0)
+    {
+        p->_args = args;
+        return;
+    }
+    _centers[i] = p->center();
+    int old = _count[i], n = args.size();
+    if (n > old)
+    {
+        // 原来的位置整个作废
+        _garbage += old;
+        _start[i] = _arena.size();
+        _arena.resize(_arena.size() + n);
+    }
+    else
+        _garbage += old - n;
+    std::copy(args.constBegin(), args.constEnd(), _arena.begin() + _start[i]);
+    _count[i] = n;
+    if (_garbage > 1024 && _garbage > _arena.size() / 2)
+        compact();
+}
+
+void Store::compact()
+{
+    QVector<QPoint> arena;
+    arena.reserve(_arena.size() - _garbage);
+    for (int i = 0; i < _start.size(); ++i)
+    {
+        int start = arena.size();
+        arena.append(_arena.mid(_start[i], _count[i]));
+        _start[i] = start;
+    }
+    _arena.swap(arena);
+    _garbage = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include "primitive.h"
+#include <QHash>
+#include <QList>
+#include <QPen>
+#include <QPoint>
+#include <QVector>
+
+// 图元存储：图元对象按块分配在对象池中，删除前地址不变，指针即为稳定的句柄，删除后槽位留给新图元。
+// 按绘制顺序用结构数组存放类型、画笔序号、中心和参数位置，所有图元的参数点只放在一个共享数组中，
+// 图元通过argPoints()直接读取，遍历大场景时只需顺序访问这些数组，不必逐个访问图元对象，也不产生内存分配。
+// 每个图元有一个递增的顺序号，取下时只留下空位，放回时先记下，读取绘制顺序时才一次性去掉空位并按顺序号并入，
+// 撤销或重做一次裁剪取下、放回k个图元只需O(k)，之后整理一次O(n)
+class Store
+{
+public:
+    Store();
+    ~Store();
+    Primitive *create(const QPen &pen, Primitive::Type type, const QVector<QPoint> &args);	// 创建图元并追加到末尾
+    void destroy(Primitive *p);		// 删除图元，也可以删除已取下的图元
+    void detach(Primitive *p);		// 从绘制顺序中取下图元但保留对象，由撤销记录持有
+    void attach(Primitive *p);		// 把取下的图元按顺序号放回原来的位置
+    bool contains(const Primitive *p) const;		// 图元是否在存储中，不整理绘制顺序
+    void clear();					// 删除所有图元，已取下的图元由持有者删除
+    void swap(Store &other);		// 交换两个存储中的图元
+    int size() const;				// 图元个数
+    int indexOf(const Primitive *p) const;			// 图元的绘制顺序，不在存储中时返回-1
+    const QList<Primitive *> &primitives() const;	// 按绘制顺序排列的图元
+    Primitive::Type type(int i) const;				// 第i个图元的类型
+    int pen(int i) const;							// 第i个图元的画笔序号
+    const QVector<QPen> &pens() const;				// 画笔表，相同颜色和宽度的画笔只存一份
+    QPoint center(int i) const;						// 第i个图元的中心
+    const QPoint *args(int i) const;				// 第i个图元的参数在共享数组中的起点
+    int argCount(int i) const;						// 第i个图元的参数个数
+    void update(Primitive *p, const QVector<QPoint> &args);	// 写入图元的新参数并同步结构数组，由Primitive调用
+private:
+    friend class Primitive;
+    Q_DISABLE_COPY(Store)
+    void compact();					// 废弃的参数过多时重新紧凑排列共享数组
+    void settle();					// 去掉取下留下的空位，并入放回的图元
+    void settle() const { const_cast<Store *>(this)->settle(); }	// 读取时按需整理，不改变存储的内容
+    void append(Primitive *p);		// 把图元追加到结构数组末尾
+    QVector<Primitive *> _blocks;	// 对象池中的块
+    QVector<Primitive *> _free;		// 空闲槽位
+    QList<Primitive *> _order;		// 按绘制顺序排列的图元，取下的位置为空
+    QVector<Primitive *> _attached;	// 已放回但尚未并入的图元
+    int _holes;						// 取下留下的空位数
+    quint64 _next;					// 下一个新建图元的顺序号
+    QVector<quint8> _types;			// 图元类型
+    QVector<int> _pens;				// 画笔序号
+    QVector<QPoint> _centers;		// 图元中心
+    QVector<int> _start;			// 参数在共享数组中的起点
+    QVector<int> _count;			// 参数个数
+    QVector<QPoint> _arena;			// 所有图元的参数
+    int _garbage;					// 共享数组中已废弃的参数个数
+    QVector<QPen> _penTable;		// 画笔表
+    QHash<quint64, int> _penIndex;	// 颜色和宽度到画笔序号的映射
+};
+
+#endif // STORE_H
@@ -0,0 +1,125 @@
+#ifndef STROKER_H
+#define STROKER_H
+
+#include <QPen>
+#include <QRect>
+#include <QPair>
+#include <QVector>
+#include <QtMath>
+#include <climits>
+#include <algorithm>
+
+// 粗画笔描边：收集中心线的像素区间，按画笔形状扩展到相邻扫描线，每条扫描线上的区间合并后只写一次，
+// 每个像素不会被重复写入，耗时与描边面积成正比。方头画笔的形状是边长为画笔宽度的正方形，
+// 与逐点绘制方块的结果一致；圆头画笔是直径为画笔宽度的圆，端点和多边形拐角随之成为圆形
+template <typename Sink>
+class Stroker
+{
+public:
+    Stroker(Sink &sink, const QPen &pen, QRect clip = QRect());
+    void plot(int x, int y) { span(y, x, x); }
+    void span(int y, int l, int r);		// 接收中心线区间，可以无序
+    void finish();						// 输出描边后的区间
+private:
+    struct Run
+    {
+        int y, l, r;
+        bool operator<(const Run &o) const { return y < o.y || (y == o.y && l < o.l); }
+    };
+    Sink &_sink;
+    int _width, _half;					// 画笔宽度，中心线上方覆盖的行数
+    int _l, _t, _r, _b;					// 只输出该范围内的扫描线和像素
+    QVector<int> _left, _right;			// 画笔形状每行相对中心的左右边界
+    QVector<Run> _runs;					// 中心线区间
+    bool _sorted;						// 中心线区间是否已按扫描线排好
+    QVector<QPair<int, int>> _row;		// 当前扫描线上扩展后的区间
+};
+
+template <typename Sink>
+Stroker<Sink>::Stroker(Sink &sink, const QPen &pen, QRect clip)
+    : _sink(sink), _width(qMax(pen.width(), 1)), _half(_width / 2), _sorted(true)
+{
+    _l = clip.isNull() ? INT_MIN / 2 : clip.left();
+    _t = clip.isNull() ? INT_MIN / 2 : clip.top();
+    _r = clip.isNull() ? INT_MAX / 2 : clip.right();
+    _b = clip.isNull() ? INT_MAX / 2 : clip.bottom();
+    // 形状覆盖相对中心的[-half, width-1-half]，宽度为偶数时圆心在像素之间
+    qreal c = (_width - 1) / 2.0 - _half, radius = _width / 2.0;
+    for (int j = -_half; j < _width - _half; ++j)
+    {
+        if (pen.capStyle() == Qt::RoundCap)
+        {
+            qreal s = qSqrt(radius * radius - (j - c) * (j - c));
+            _left.append(qCeil(c - s));
+            _right.append(qFloor(c + s));
+        }
+        else
+        {
+            _left.append(-_half);
+            _right.append(_width - 1 - _half);
+        }
+    }
+}
+
+template <typename Sink>
+void Stroker<Sink>::span(int y, int l, int r)
+{
+    // 扩展后也碰不到输出范围的区间直接丢弃
+    if (y + _width - 1 - _half < _t || y - _half > _b || r + _width < _l || l - _width > _r)
+        return;
+    if (!_runs.isEmpty() && Run{y, l, r} < _runs.last())
+        _sorted = false;
+    _runs.append({y, l, r});
+}
+
+template <typename Sink>
+void Stroker<Sink>::finish()
+{
+    if (_runs.isEmpty())
+        return;
+    if (!_sorted)
+        std::sort(_runs.begin(), _runs.end());
+    // 扫描线y的像素来自中心线上第y-down到y+half行的区间
+    int down = _width - 1 - _half, n = _runs.size(), lo = 0, hi = 0;
+    int y = qMax(_runs.first().y - _half, _t), last = qMin(_runs.last().y + down, _b);
+    while (y <= last)
+    {
+        while (lo < n && _runs[lo].y < y - down)
+            ++lo;
+        while (hi < n && _runs[hi].y <= y + _half)
+            ++hi;
+        if (lo == hi)
+        {
+            // 中心线在这里断开，跳到下一段
+            if (hi == n)
+                break;
+            y = qMax(_runs[hi].y - _half, y + 1);
+            continue;
+        }
+        _row.clear();
+        for (int i = lo; i < hi; ++i)
+        {
+            int j = y - _runs[i].y + _half;
+            _row.append(qMakePair(_runs[i].l + _left[j], _runs[i].r + _right[j]));
+        }
+        if (_row.size() > 1)
+            std::sort(_row.begin(), _row.end());
+        QPair<int, int> cur = _row.first();
+        for (int i = 1; i < _row.size(); ++i)
+        {
+            if (_row[i].first <= cur.second + 1)
+                cur.second = qMax(cur.second, _row[i].second);
+            else
+            {
+                _sink.fill(y, qMax(cur.first, _l), qMin(cur.second, _r));
+                cur = _row[i];
+            }
+        }
+        _sink.fill(y, qMax(cur.first, _l), qMin(cur.second, _r));
+        ++y;
+    }
+    _runs.clear();
+    _sorted = true;
+}
+
+#endif // STROKER_H
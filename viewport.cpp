@@ -0,0 +1,66 @@
+#include "viewport.h"
+#include <QtMath>
+
+Viewport::Viewport()
+{
+    reset();
+}
+
+qreal Viewport::scale() const
+{
+    return _scale;
+}
+
+QPointF Viewport::origin() const
+{
+    return _origin;
+}
+
+QTransform Viewport::transform() const
+{
+    return QTransform(_scale, 0, 0, _scale, -_origin.x() * _scale, -_origin.y() * _scale);
+}
+
+QPoint Viewport::toWorld(QPoint p) const
+{
+    return QPoint(qFloor(p.x() / _scale + _origin.x()), qFloor(p.y() / _scale + _origin.y()));
+}
+
+QRect Viewport::toWorld(QRect r) const
+{
+    if (r.isNull())
+        return QRect();
+    return QRect(QPoint(qFloor(r.left() / _scale + _origin.x()) - 1, qFloor(r.top() / _scale + _origin.y()) - 1),
+                 QPoint(qCeil((r.right() + 1) / _scale + _origin.x()), qCeil((r.bottom() + 1) / _scale + _origin.y())));
+}
+
+QRect Viewport::toScreen(QRect r) const
+{
+    if (r.isNull())
+        return QRect();
+    return QRect(QPoint(qFloor((r.left() - _origin.x()) * _scale) - 1, qFloor((r.top() - _origin.y()) * _scale) - 1),
+                 QPoint(qCeil((r.right() + 1 - _origin.x()) * _scale), qCeil((r.bottom() + 1 - _origin.y()) * _scale)));
+}
+
+void Viewport::pan(QPoint delta)
+{
+    _origin -= QPointF(delta) / _scale;
+}
+
+void Viewport::zoom(qreal factor, QPoint anchor)
+{
+    QPointF world = QPointF(anchor) / _scale + _origin;
+    _scale = qBound(1.0 / 64, _scale * factor, 64.0);
+    // 缩放回到1时把原点取整，平移重新走缓存的光栅化结果
+    if (qAbs(_scale - 1) < 1e-9)
+        _scale = 1;
+    _origin = world - QPointF(anchor) / _scale;
+    if (_scale == 1)
+        _origin = QPointF(qRound(_origin.x()), qRound(_origin.y()));
+}
+
+void Viewport::reset()
+{
+    _origin = QPointF(0, 0);
+    _scale = 1;
+}
@@ -0,0 +1,29 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QTransform>
+
+// 视口：世界坐标到画布坐标的平移和缩放，图元参数始终是世界坐标，画布是视口看到的部分。
+// 画布坐标 = (世界坐标 - 原点) * 缩放
+class Viewport
+{
+public:
+    Viewport();
+    qreal scale() const;				// 缩放倍数
+    QPointF origin() const;				// 画布左上角对应的世界坐标
+    QTransform transform() const;		// 世界坐标到画布坐标的变换
+    QPoint toWorld(QPoint p) const;		// 画布上的点对应的世界坐标
+    QRect toWorld(QRect r) const;		// 画布矩形覆盖的世界矩形，向外多取一个像素
+    QRect toScreen(QRect r) const;		// 世界矩形覆盖的画布矩形，向外多取一个像素，覆盖取整误差
+    void pan(QPoint delta);				// 按画布像素平移
+    void zoom(qreal factor, QPoint anchor);	// 以画布上的anchor为中心缩放，保持anchor处的世界坐标不变
+    void reset();						// 回到原点，不缩放
+private:
+    QPointF _origin;	// 画布左上角对应的世界坐标
+    qreal _scale;		// 缩放倍数，限制在1/64到64之间
+};
+
+#endif // VIEWPORT_H